@@ -10,6 +10,7 @@ package com.cff.anebe
 	import flash.utils.ByteArray;
 	import com.cff.anebe.ir.ASScript;
 	import com.cff.anebe.ir.ASMethod;
+	import com.cff.anebe.ir.ASUsage;
 
 	/**
 	 * The main interface of this library. Allows editing bytecode of passed in SWF files.
@@ -159,6 +160,64 @@ package com.cff.anebe
 			}
 		}
 
+		/**
+		 * Disassembles SWF straight to disk. Each file is written as soon as it is disassembled, so the disassembly is never held in memory all at once.
+		 * @param swf The SWF to disassemble
+		 * @param path Directory to write the files into, or the path of an archive to write them to if it ends in .tar or .basasm
+		 */
+		public function DisassembleToPath(swf:ByteArray, path:String):void
+		{
+			setSWF(Utils.decompressSWF(swf));
+
+			var ret:Object = extContext.call("DisassembleToPath", currentSWF, path);
+
+			if (ret is String)
+			{
+				throw new Error(ret);
+			}
+			else if (ret is NestedError)
+			{
+				throw ret;
+			}
+			else if (ret == null || !(ret is Boolean))
+			{
+				throw new Error("Unknown error occurred during DisassembleToPath");
+			}
+			else if (!(ret as Boolean))
+			{
+				throw new Error("DisassembleToPath returned false somehow");
+			}
+		}
+
+		/**
+		 * Disassembles SWF straight to disk, asynchronously. To know when it's done, subscribe to the DISASSEMBLY_WRITTEN event.
+		 * @param swf The SWF to disassemble
+		 * @param path Directory to write the files into, or the path of an archive to write them to if it ends in .tar or .basasm
+		 */
+		public function DisassembleToPathAsync(swf:ByteArray, path:String):void
+		{
+			setSWF(Utils.decompressSWF(swf));
+
+			var ret:Object = extContext.call("DisassembleToPathAsync", currentSWF, path);
+
+			if (ret is String)
+			{
+				throw new Error(ret);
+			}
+			else if (ret is NestedError)
+			{
+				throw ret;
+			}
+			else if (ret == null || !(ret is Boolean))
+			{
+				throw new Error("Unknown error occurred during DisassembleToPathAsync");
+			}
+			else if (!(ret as Boolean))
+			{
+				throw new Error("DisassembleToPathAsync returned false somehow");
+			}
+		}
+
 		/**
 		 * Assembles an SWF from a map of file name to file contents, asynchronously. To retrieve the data, subscribe to the ASSEMBLY_DONE event.
 		 * @param strings File name and contents map
@@ -206,6 +265,90 @@ package com.cff.anebe
 			}
 		}
 
+		/**
+		 * Assembles an SWF from a disassembly archive written by DisassembleToPath. Files are read from the archive as they are included, rather than all being loaded first.
+		 * @param path Path of the .basasm archive
+		 * @param includeDebugInstructions Whether to include debug instructions in the built SWF
+		 * @param replaceSWF SWF data to replace the DoABC2 tag within, or null to use last disassembled.
+		 * @return The new SWF data.
+		 */
+		public function AssembleFromPath(path:String, includeDebugInstructions:Boolean, replaceSWF:ByteArray = null):ByteArray
+		{
+			if (path == null)
+			{
+				throw new Error("Cannot assemble from a null path");
+			}
+			if (replaceSWF != null)
+			{
+				setSWF(Utils.decompressSWF(replaceSWF));
+			}
+			if (currentSWF == null)
+			{
+				throw new Error("Cannot assemble without an SWF");
+			}
+
+			var ret:Object = extContext.call("AssembleFromPath", path, includeDebugInstructions);
+
+			if (ret is String)
+			{
+				throw new Error(ret);
+			}
+			else if (ret is NestedError)
+			{
+				throw ret;
+			}
+			else if (ret == null || !(ret is ByteArray))
+			{
+				throw new Error("Unknown error occurred");
+			}
+			else
+			{
+				insertABC(ret as ByteArray);
+				return currentSWF;
+			}
+		}
+
+		/**
+		 * Assembles an SWF from a disassembly archive written by DisassembleToPath, asynchronously. To retrieve the data, subscribe to the ASSEMBLY_DONE event.
+		 * @param path Path of the .basasm archive
+		 * @param includeDebugInstructions Whether to include debug instructions in the built SWF
+		 * @param replaceSWF SWF data to replace the DoABC2 tag within, or null to use last disassembled.
+		 */
+		public function AssembleFromPathAsync(path:String, includeDebugInstructions:Boolean, replaceSWF:ByteArray = null):void
+		{
+			if (path == null)
+			{
+				throw new Error("Cannot assemble from a null path");
+			}
+			if (replaceSWF != null)
+			{
+				setSWF(Utils.decompressSWF(replaceSWF));
+			}
+			if (currentSWF == null)
+			{
+				throw new Error("Cannot assemble without an SWF");
+			}
+
+			var ret:Object = extContext.call("AssembleFromPathAsync", path, includeDebugInstructions);
+
+			if (ret is String)
+			{
+				throw new Error(ret);
+			}
+			else if (ret is NestedError)
+			{
+				throw ret;
+			}
+			else if (ret == null || !(ret is Boolean))
+			{
+				throw new Error("Unknown error occurred");
+			}
+			else if (!(ret as Boolean))
+			{
+				throw new Error("AssembleFromPathAsync returned false somehow");
+			}
+		}
+
 		/**
 		 * Cleans up any temporary data that was necessary during assembly or disassembly.
 		 */
@@ -215,6 +358,36 @@ package com.cff.anebe
 			currentSWF = null;
 		}
 
+		/**
+		 * Sets whether assembly orders constant pools to make the output as small as possible, rather than by how often each constant is used.
+		 * Makes assembly noticeably slower, for a DoABC2 tag that is usually only slightly smaller. Off by default.
+		 * @param minimize Whether to minimize the size of constant pool references
+		 */
+		public function SetMinimizePoolSizes(minimize:Boolean):void
+		{
+			extContext.call("SetMinimizePoolSizes", minimize);
+		}
+
+		/**
+		 * Sets a directory in which full disassemblies cache the code of method bodies, so that disassembling an SWF again only redoes the methods that changed.
+		 * Only the entries used by the most recent disassembly are kept. Off by default.
+		 * @param directory Path of the cache directory, or null to turn the cache off
+		 */
+		public function SetDisassemblyCache(directory:String):void
+		{
+			extContext.call("SetDisassemblyCache", directory);
+		}
+
+		/**
+		 * Sets whether assembly keeps the parsed top-level includes of main.asasm in memory, so that assembling the same project again only reparses the files that changed.
+		 * The cache is emptied by Cleanup. Off by default.
+		 * @param enable Whether to keep parsed includes between assemblies
+		 */
+		public function SetParseCache(enable:Boolean):void
+		{
+			extContext.call("SetParseCache", enable);
+		}
+
 		/**
 		 * Partially assembles an SWF from a map of file name to file contents.
 		 * This is meant to be used to allow using the GetClass function, which can provide a higher level interface to bytecode edits than text edits.
@@ -305,6 +478,7 @@ package com.cff.anebe
 
 		/**
 		 * Finishes assembly started by PartialAssemble or PartialAssembleAsync.
+		 * The partial assembly is kept until Cleanup, so it can be edited further and finished again; later calls only redo the work affected by the edits in between.
 		 * @param replaceSWF SWF data to replace the DoABC2 tag within, or null to use last disassembled.
 		 * @return The modified SWF data.
 		 */
@@ -342,6 +516,7 @@ package com.cff.anebe
 
 		/**
 		 * Finishes assembly started by PartialAssemble or PartialAssembleAsync. To retrieve the data, subscribe to the ASSEMBLY_DONE event.
+		 * The partial assembly is kept until Cleanup, so it can be edited further and finished again; later calls only redo the work affected by the edits in between.
 		 * @param replaceSWF SWF data to replace the DoABC2 tag within, or null to use last disassembled.
 		 */
 		public function FinishAssembleAsync(replaceSWF:ByteArray = null):void
@@ -523,6 +698,69 @@ package com.cff.anebe
 			}
 		}
 
+		/**
+		 * Finds every instruction that references a multiname, such as calls, property accesses and type checks.
+		 * @param name The multiname to look for. Must match exactly, including namespaces.
+		 * @return Where the multiname is used
+		 */
+		public function FindMultinameUsages(name:ASMultiname):Vector.<ASUsage>
+		{
+			if (name == null)
+			{
+				throw new ArgumentError("Multiname must not be null");
+			}
+
+			return checkUsages(extContext.call("FindMultinameUsages", name));
+		}
+
+		/**
+		 * Finds every instruction that references a string, such as pushstring or debugfile.
+		 * @param str The string to look for
+		 * @return Where the string is used
+		 */
+		public function FindStringUsages(str:String):Vector.<ASUsage>
+		{
+			if (str == null)
+			{
+				throw new ArgumentError("String must not be null");
+			}
+
+			return checkUsages(extContext.call("FindStringUsages", str));
+		}
+
+		/**
+		 * Finds every instruction that references a class; in practice, every newclass for it.
+		 * @param clazz The class to look for
+		 * @return Where the class is used
+		 */
+		public function FindClassUsages(clazz:ASClass):Vector.<ASUsage>
+		{
+			if (clazz == null)
+			{
+				throw new ArgumentError("Class must not be null");
+			}
+
+			return checkUsages(extContext.call("FindClassUsages", clazz));
+		}
+
+		private function checkUsages(ret:Object):Vector.<ASUsage>
+		{
+			if (ret is String)
+			{
+				throw new Error(ret);
+			}
+			else if (ret is NestedError)
+			{
+				throw ret;
+			}
+			else if (!(ret is Vector.<ASUsage>))
+			{
+				throw new Error("An unspecified error occurred");
+			}
+
+			return ret as Vector.<ASUsage>;
+		}
+
 		private function onStatusEvent(e:StatusEvent):void
 		{
 			if (e.level == "ERROR")
@@ -573,6 +811,11 @@ package com.cff.anebe
 				extContext.call("AsyncTaskResult");
 				this.dispatchEvent(new Event(Events.PARTIAL_ASSEMBLY_DONE));
 			}
+			else if (e.level == "DisassemblyWritten")
+			{
+				extContext.call("AsyncTaskResult");
+				this.dispatchEvent(new Event(Events.DISASSEMBLY_WRITTEN));
+			}
 		}
 	}
 }
@@ -8,6 +8,7 @@ package com.cff.anebe
 	{
 		public static const ASSEMBLY_DONE:String = "ASSEMBLY_DONE";
 		public static const DISASSEMBLY_DONE:String = "DISASSEMBLY_DONE";
+		public static const DISASSEMBLY_WRITTEN:String = "DISASSEMBLY_WRITTEN";
 		public static const PARTIAL_ASSEMBLY_DONE:String = "PARTIAL_ASSEMBLY_DONE";
 	}
 
@@ -5,6 +5,7 @@ package com.cff.anebe
     import com.cff.anebe.ir.ASMultiname;
     import com.cff.anebe.ir.ASReadOnlyClass;
     import com.cff.anebe.ir.ASReadOnlyScript;
+    import com.cff.anebe.ir.ASUsage;
 
     /**
      * Partially disassembles an SWF so that high-level information can be pulled out of it. Does not allow rebuilding and editing.
@@ -160,5 +161,68 @@ package com.cff.anebe
 
             return ret as Vector.<ASMultiname>;
         }
+
+        /**
+         * Finds every instruction that references a multiname, such as calls, property accesses and type checks.
+         * @param name The multiname to look for. Must match exactly, including namespaces.
+         * @return Where the multiname is used
+         */
+        public function FindMultinameUsages(name:ASMultiname):Vector.<ASUsage>
+        {
+            if (name == null)
+            {
+                throw new ArgumentError("Multiname must not be null");
+            }
+
+            return checkUsages(extContext.call("FindMultinameUsages", name));
+        }
+
+        /**
+         * Finds every instruction that references a string, such as pushstring or debugfile.
+         * @param str The string to look for
+         * @return Where the string is used
+         */
+        public function FindStringUsages(str:String):Vector.<ASUsage>
+        {
+            if (str == null)
+            {
+                throw new ArgumentError("String must not be null");
+            }
+
+            return checkUsages(extContext.call("FindStringUsages", str));
+        }
+
+        /**
+         * Finds every instruction that references a class; in practice, every newclass for it.
+         * @param clazz The class to look for
+         * @return Where the class is used
+         */
+        public function FindClassUsages(clazz:ASReadOnlyClass):Vector.<ASUsage>
+        {
+            if (clazz == null)
+            {
+                throw new ArgumentError("Class must not be null");
+            }
+
+            return checkUsages(extContext.call("FindClassUsages", clazz));
+        }
+
+        private function checkUsages(ret:Object):Vector.<ASUsage>
+        {
+            if (ret is String)
+            {
+                throw new Error(ret);
+            }
+            else if (ret is NestedError)
+            {
+                throw ret;
+            }
+            else if (!(ret is Vector.<ASUsage>))
+            {
+                throw new Error("An unspecified error occurred");
+            }
+
+            return ret as Vector.<ASUsage>;
+        }
     }
 }
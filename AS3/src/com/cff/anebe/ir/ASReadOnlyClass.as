@@ -312,6 +312,31 @@ package com.cff.anebe.ir
             return ret as ASNamespace;
         }
 
+        /**
+         * Disassembles just this class, into the same files a full disassembly would give it.
+         * Only the first call after a change to the program looks at the whole program.
+         * @return The new map of file name to file contents.
+         */
+        public function disassemble():Object
+        {
+            var ret:Object = context.call("Disassemble");
+
+            if (ret is String)
+            {
+                throw new Error(ret);
+            }
+            else if (ret is NestedError)
+            {
+                throw ret;
+            }
+            if (ret == null)
+            {
+                throw new Error("An unspecified error occurred");
+            }
+
+            return ret;
+        }
+
         /** Used internally */
         public function setNativePointerForConversion():void
         {
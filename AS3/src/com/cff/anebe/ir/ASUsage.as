@@ -0,0 +1,26 @@
+package com.cff.anebe.ir
+{
+    /**
+     * A place in a method body where something is referenced, as returned by the Find*Usages functions.
+     * @author Chris
+     */
+    public class ASUsage
+    {
+        /** The method whose body contains the referencing instruction */
+        public var method:ASMethod;
+
+        /** Index of the referencing instruction in method.body.instructions */
+        public var instruction:uint;
+
+        /**
+         * Builds a usage. Likely should only be used internally.
+         * @param method The method containing the reference
+         * @param instruction Index of the instruction making the reference
+         */
+        public function ASUsage(method:ASMethod = null, instruction:uint = 0)
+        {
+            this.method = method;
+            this.instruction = instruction;
+        }
+    }
+}
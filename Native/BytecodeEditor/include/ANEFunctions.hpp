@@ -15,6 +15,10 @@ inline std::optional<ANEFunctionContext> nextObjectContext;
 template <FREObject (BytecodeEditor::*Assembler)(
     std::unordered_map<std::string, std::string>&&, bool)>
 FREObject Assemble(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[]);
+template <FREObject (BytecodeEditor::*Disassembler)(std::span<const uint8_t>, std::string&&)>
+FREObject DisassembleToPath(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[]);
+template <FREObject (BytecodeEditor::*Assembler)(std::string&&, bool)>
+FREObject AssembleFromPath(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[]);
 template <FREObject (BytecodeEditor::*Function)()>
 FREObject TransparentZeroArg(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[]);
 template <FREObject (*Function)(FREContext, void*, uint32_t, FREObject[])>
@@ -24,6 +28,9 @@ FREObject CheckAssemblyValid(FREContext ctx, void* funcData, uint32_t argc, FREO
 
 FREObject SetCurrentSWF(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[]);
 FREObject Cleanup(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[]);
+FREObject SetMinimizePoolSizes(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[]);
+FREObject SetDisassemblyCache(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[]);
+FREObject SetParseCache(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[]);
 FREObject GetClass(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[]);
 FREObject GetScript(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[]);
 FREObject GetROClass(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[]);
@@ -31,6 +38,10 @@ FREObject GetROScript(FREContext ctx, void* funcData, uint32_t argc, FREObject a
 
 FREObject CreateScript(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[]);
 
+FREObject FindMultinameUsages(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[]);
+FREObject FindStringUsages(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[]);
+FREObject FindClassUsages(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[]);
+
 FREObject InsertABCToSWF(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[]);
 
 namespace ASClass
@@ -71,6 +82,9 @@ namespace ASClass
 
     // Allows converting an FREObject back to a shared_ptr
     FREObject ConvertClassHelper(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[]);
+
+    // ASASM text of just this class
+    FREObject Disassemble(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[]);
 }
 
 namespace ASScript
@@ -85,4 +99,6 @@ namespace ASScript
     FREObject DeleteTrait(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[]);
     // Adding classes
     FREObject CreateClass(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[]);
+    // ASASM text of just this script
+    FREObject Disassemble(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[]);
 }
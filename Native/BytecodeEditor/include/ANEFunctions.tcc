@@ -73,6 +73,55 @@ FREObject Disassemble(FREContext, void* funcData, uint32_t argc, FREObject argv[
     return ret;
 }
 
+template <FREObject (BytecodeEditor::*Disassembler)(std::span<const uint8_t>, std::string&&)>
+FREObject DisassembleToPath(FREContext, void* funcData, uint32_t argc, FREObject argv[])
+{
+    CHECK_ARGC(2);
+
+    GET_EDITOR();
+
+    CHECK_OBJECT<FRE_TYPE_BYTEARRAY>(argv[0]);
+    std::string path;
+    try
+    {
+        path = CHECK_STRING<false>(argv[1]);
+    }
+    catch (FREObject o)
+    {
+        return o;
+    }
+
+    FREByteArray ba;
+    DO_OR_FAIL("Could not acquire SWF byte data", FREAcquireByteArray(argv[0], &ba));
+
+    FREObject ret = (editor.*Disassembler)({ba.bytes, ba.length}, std::move(path));
+
+    DO_OR_FAIL("Could not release SWF byte data", FREReleaseByteArray(argv[0]));
+
+    return ret;
+}
+
+template <FREObject (BytecodeEditor::*Assembler)(std::string&&, bool)>
+FREObject AssembleFromPath(FREContext, void* funcData, uint32_t argc, FREObject argv[])
+{
+    CHECK_ARGC(2);
+
+    GET_EDITOR();
+
+    bool includeDebugInstructions = CHECK_OBJECT<FRE_TYPE_BOOLEAN>(argv[1]);
+    std::string path;
+    try
+    {
+        path = CHECK_STRING<false>(argv[0]);
+    }
+    catch (FREObject o)
+    {
+        return o;
+    }
+
+    return (editor.*Assembler)(std::move(path), includeDebugInstructions);
+}
+
 template <auto Function>
     requires std::same_as<decltype(Function), FREObject (BytecodeEditor::*)()> ||
              std::same_as<decltype(Function), FREObject (BytecodeEditor::*)() const>
@@ -30,6 +30,8 @@ namespace ASASM
         std::vector<std::shared_ptr<Method>> orphanMethods;
 
         static ASProgram fromABC(const SWFABC::ABCFile& abc);
-        SWFABC::ABCFile toABC();
+        // minimizePoolSizes orders the constant pools for the smallest output instead of by use
+        // count, at the cost of lowering the program twice
+        SWFABC::ABCFile toABC(bool minimizePoolSizes = false);
     };
 }
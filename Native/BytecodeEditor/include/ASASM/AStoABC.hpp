@@ -1,353 +1,290 @@
 #pragma once
 
 #include "ABC/ABCFile.hpp"
-#include "ASASM/ASTraitsVisitor.hpp"
+#include "ASASM/ASProgram.hpp"
 #include "ASASM/Class.hpp"
+#include "ASASM/ConstantCollector.hpp"
 #include "ASASM/Metadata.hpp"
 #include "ASASM/Method.hpp"
 #include "ASASM/Multiname.hpp"
 #include "ASASM/Namespace.hpp"
+#include "enums/InstanceFlags.hpp"
+#include "enums/MethodFlags.hpp"
+#include "enums/TraitAttribute.hpp"
+#include "utils/Parallel.hpp"
 #include "utils/ValuePool.hpp"
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <memory>
+#include <optional>
 #include <stdint.h>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace ASASM
 {
-    class AStoABC : public ASTraitsVisitor
+    class AStoABC : public ConstantCollector
     {
-    public:
-        ValuePool<int64_t> ints;
-        ValuePool<uint64_t> uints;
-        ValuePool<double> doubles;
-        ValuePool<std::optional<std::string>> strings;
-        ValuePool<ASASM::Namespace> namespaces;
-        ValuePool<std::vector<ASASM::Namespace>> namespaceSets;
-        ValuePool<ASASM::Multiname> multinames;
-        ValuePool<ASASM::Metadata, false> metadatas;
-        ValuePool<std::shared_ptr<ASASM::Class>, false> classes;
-        ValuePool<std::shared_ptr<ASASM::Method>, false> methods;
-
-        SWFABC::ABCFile abc;
-
-        void visitInt(int64_t v) { ints.add(v); }
-
-        void visitUint(uint64_t v) { uints.add(v); }
+    private:
+        // The pools an index in the ABC file can refer to
+        enum class Pool : uint8_t
+        {
+            Int,
+            UInt,
+            Double,
+            String,
+            Namespace,
+            NamespaceSet,
+            Multiname,
+            Metadata,
+            Class,
+            Method,
+            Count
+        };
 
-        void visitDouble(double v) { doubles.add(v); }
+        // Constants are counted per shard of the program's scripts, classes and methods. Objects
+        // are spread over the shards by address, so that between two lowerings only the shards
+        // holding changed, added or removed objects need to be counted again.
+        struct Shard
+        {
+            ConstantCollector constants = ConstantCollector(false);
+            std::vector<std::shared_ptr<ASASM::Script>> scripts;
+            std::vector<std::shared_ptr<ASASM::Class>> classes;
+            std::vector<std::shared_ptr<ASASM::Method>> methods;
+        };
 
-        void visitString(const std::optional<std::string>& v) { strings.add(v); }
+        static constexpr size_t shardBits = 6;
 
-        void visitNamespace(const Namespace& ns)
+        // A copy of a pool as of the last buildABC, to tell which of its indices still hold the
+        // same value
+        template <typename T>
+        struct PoolSnapshot
         {
-            if (namespaces.add(ns))
+            std::vector<T> values;
+            std::vector<bool> unchanged;
+
+            void compare(const std::vector<T>& current)
             {
-                if (ns.kind != ABCType::Void)
+                unchanged.assign(values.size(), false);
+                for (size_t i = 0; i < std::min(values.size(), current.size()); i++)
                 {
-                    visitString(ns.name);
+                    // Pools tell doubles apart by their bits, so 0.0 and -0.0 are different values
+                    if constexpr (std::is_same_v<T, double>)
+                    {
+                        unchanged[i] = std::bit_cast<uint64_t>(values[i]) ==
+                                       std::bit_cast<uint64_t>(current[i]);
+                    }
+                    else
+                    {
+                        unchanged[i] = values[i] == current[i];
+                    }
                 }
             }
-        }
 
-        void visitNamespaceSet(const std::vector<ASASM::Namespace>& nsSet)
-        {
-            if (namespaceSets.add(nsSet))
+            bool isUnchanged(uint32_t index) const
             {
-                for (const auto& ns : nsSet)
-                {
-                    visitNamespace(ns);
-                }
+                return index < unchanged.size() && unchanged[index];
             }
+        };
+
+        const ASASM::ASProgram& as;
+
+        std::vector<Shard> shards = std::vector<Shard>(size_t(1) << shardBits);
+        std::unordered_set<const void*> changed;
+
+        PoolSnapshot<int64_t> previousInts;
+        PoolSnapshot<uint64_t> previousUints;
+        PoolSnapshot<double> previousDoubles;
+        PoolSnapshot<std::optional<std::string>> previousStrings;
+        PoolSnapshot<ASASM::Namespace> previousNamespaces;
+        PoolSnapshot<ASASM::Multiname> previousMultinames;
+        PoolSnapshot<ASASM::Metadata> previousMetadatas;
+        PoolSnapshot<std::shared_ptr<ASASM::Class>> previousClasses;
+        PoolSnapshot<std::shared_ptr<ASASM::Method>> previousMethods;
+        // The method each of abc.bodies belongs to. Holding on to them keeps their addresses from
+        // being reused by new methods.
+        std::vector<std::shared_ptr<ASASM::Method>> bodyOwners;
+
+        static size_t shardOf(const void* object)
+        {
+            return size_t(
+                (uint64_t(uintptr_t(object)) * 0x9E3779B97F4A7C15ull) >> (64 - shardBits));
         }
 
-        void visitMultiname(const ASASM::Multiname& multiname)
+        // Classes and methods are numbered in the order a depth-first walk of the program first
+        // reaches them. Only the walk needs to be serial, and it only follows references between
+        // classes and methods; their constants are collected afterwards.
+        void walkTraits(const std::vector<ASASM::Trait>& traits)
         {
-            if (multinames.notAdded(multiname))
+            for (const auto& trait : traits)
             {
-                if (multiname.kind != ABCType::Void)
+                switch (trait.kind)
                 {
-                    switch (multiname.kind)
-                    {
-                        case ABCType::QName:
-                        case ABCType::QNameA:
-                            visitNamespace(multiname.qname().ns);
-                            visitString(multiname.qname().name);
-                            break;
-                        case ABCType::RTQName:
-                        case ABCType::RTQNameA:
-                            visitString(multiname.rtqname().name);
-                            break;
-                        case ABCType::RTQNameL:
-                        case ABCType::RTQNameLA:
-                            break;
-                        case ABCType::Multiname:
-                        case ABCType::MultinameA:
-                            visitString(multiname.multiname().name);
-                            visitNamespaceSet(multiname.multiname().nsSet);
-                            break;
-                        case ABCType::MultinameL:
-                        case ABCType::MultinameLA:
-                            visitNamespaceSet(multiname.multinamel().nsSet);
-                            break;
-                        case ABCType::TypeName:
-                            visitMultiname(multiname.Typename().name());
-                            for (const auto& param : multiname.Typename().params())
-                            {
-                                visitMultiname(param);
-                            }
-                            break;
-                        default:
-                            throw StringException("Unknown multiname kind");
-                    }
+                    case TraitKind::Class:
+                        if (trait.vClass().vclass)
+                        {
+                            walkClass(trait.vClass().vclass);
+                        }
+                        break;
+                    case TraitKind::Function:
+                        if (trait.vFunction().vfunction)
+                        {
+                            walkMethod(trait.vFunction().vfunction);
+                        }
+                        break;
+                    case TraitKind::Method:
+                    case TraitKind::Getter:
+                    case TraitKind::Setter:
+                        if (trait.vMethod().vmethod)
+                        {
+                            walkMethod(trait.vMethod().vmethod);
+                        }
+                        break;
+                    default:
+                        break;
                 }
-
-                bool unrecursiveMultiname = multinames.add(multiname);
-                (void)unrecursiveMultiname;
-                assert(unrecursiveMultiname);
             }
         }
 
-        void visitScript(const ASASM::Script& script)
+        void walkClass(const std::shared_ptr<ASASM::Class>& vclass)
         {
-            visitTraits(script.traits);
-            if (script.sinit)
+            if (classes.add(vclass))
             {
-                visitMethod(script.sinit);
+                walkMethod(vclass->cinit);
+                walkTraits(vclass->traits);
+                walkMethod(vclass->instance.iinit);
+                walkTraits(vclass->instance.traits);
             }
         }
 
-        void visitTrait(const ASASM::Trait& trait)
+        void walkMethod(const std::shared_ptr<ASASM::Method>& method)
         {
-            visitMultiname(trait.name);
-            switch (trait.kind)
+            if (methods.add(method) && method->vbody)
             {
-                case TraitKind::Slot:
-                case TraitKind::Const:
-                    visitMultiname(trait.vSlot().typeName);
-                    visitValue(trait.vSlot().value);
-                    break;
-                case TraitKind::Class:
-                    if (trait.vClass().vclass)
-                    {
-                        visitClass(trait.vClass().vclass);
-                    }
-                    break;
-                case TraitKind::Function:
-                    if (trait.vFunction().vfunction)
-                    {
-                        visitMethod(trait.vFunction().vfunction);
-                    }
-                    break;
-                case TraitKind::Method:
-                case TraitKind::Getter:
-                case TraitKind::Setter:
-                    if (trait.vMethod().vmethod)
+                const auto& body = *method->vbody;
+                if (body.method.lock() == nullptr)
+                {
+                    return;
+                }
+
+                for (const auto& instruction : body.instructions)
+                {
+                    const auto& argTypes = OPCode_Info[(uint8_t)instruction.opcode].second;
+                    for (size_t i = 0; i < argTypes.size(); i++)
                     {
-                        visitMethod(trait.vMethod().vmethod);
+                        if (argTypes[i] == OPCodeArgumentType::Class)
+                        {
+                            walkClass(instruction.arguments[i].classv());
+                        }
+                        else if (argTypes[i] == OPCodeArgumentType::Method)
+                        {
+                            walkMethod(instruction.arguments[i].methodv());
+                        }
                     }
-                    break;
-                default:
-                    throw StringException("Unknown trait kind");
-            }
-            for (const auto& md : trait.metadata)
-            {
-                visitMetadata(md);
+                }
+
+                walkMethod(body.method.lock());
+                walkTraits(body.traits);
             }
         }
 
-        void visitMetadata(const ASASM::Metadata& metadata)
+    public:
+        SWFABC::ABCFile abc;
+
+        void run()
         {
-            if (metadatas.add(metadata))
+            for (const auto& script : as.scripts)
             {
-                if (!metadata.data.empty())
+                walkTraits(script->traits);
+                if (script->sinit)
                 {
-                    visitString(metadata.name);
-                    for (const auto& md : metadata.data)
-                    {
-                        visitString(md.first);
-                        visitString(md.second);
-                    }
+                    walkMethod(script->sinit);
                 }
             }
-        }
+            for (const auto& vclass : as.orphanClasses)
+            {
+                walkClass(vclass);
+            }
+            for (const auto& vmethod : as.orphanMethods)
+            {
+                walkMethod(vmethod);
+            }
 
-        void visitValue(const ASASM::Value& value)
-        {
-            switch (value.vkind)
+            // Every script, class and method has its own constants visited exactly once, in
+            // shards that are merged in order. Counts don't depend on how objects are split up, so
+            // the pools come out the same as from a single pass.
+            std::vector<Shard> members(shards.size());
+            for (const auto& script : as.scripts)
             {
-                case ABCType::Integer:
-                    visitInt(value.vint());
-                    break;
-                case ABCType::UInteger:
-                    visitUint(value.vuint());
-                    break;
-                case ABCType::Double:
-                    visitDouble(value.vdouble());
-                    break;
-                case ABCType::Utf8:
-                    visitString(value.vstring());
-                    break;
-                case ABCType::Namespace:
-                case ABCType::PackageNamespace:
-                case ABCType::PackageInternalNs:
-                case ABCType::ProtectedNamespace:
-                case ABCType::ExplicitNamespace:
-                case ABCType::StaticProtectedNs:
-                case ABCType::PrivateNamespace:
-                    visitNamespace(value.vnamespace());
-                    break;
-                case ABCType::True:
-                case ABCType::False:
-                case ABCType::Null:
-                case ABCType::Undefined:
-                    break;
-                default:
-                    throw StringException("Unknown value type");
+                members[shardOf(script.get())].scripts.emplace_back(script);
+            }
+            for (const auto& vclass : classes.getPreliminaryValues())
+            {
+                members[shardOf(vclass.get())].classes.emplace_back(vclass);
+            }
+            for (const auto& method : methods.getPreliminaryValues())
+            {
+                members[shardOf(method.get())].methods.emplace_back(method);
             }
-        }
 
-        void visitClass(const std::shared_ptr<ASASM::Class>& vclass)
-        {
-            if (classes.add(vclass))
+            // Methods are only ever replaced, never edited in place, so they can't be changed
+            // without their shard's members changing as well
+            const auto isChanged = [this](const auto& object)
+            {
+                return changed.contains(object.get());
+            };
+
+            std::vector<size_t> stale;
+            for (size_t i = 0; i < shards.size(); i++)
             {
-                if (vclass)
+                if (members[i].scripts != shards[i].scripts ||
+                    members[i].classes != shards[i].classes ||
+                    members[i].methods != shards[i].methods ||
+                    std::ranges::any_of(members[i].scripts, isChanged) ||
+                    std::ranges::any_of(members[i].classes, isChanged))
                 {
-                    visitMethod(vclass->cinit);
-                    visitTraits(vclass->traits);
-                    visitInstance(vclass->instance);
+                    stale.emplace_back(i);
                 }
             }
-        }
 
-        void visitMethod(const std::shared_ptr<ASASM::Method>& method)
-        {
-            if (methods.add(method))
-            {
-                if (method)
+            // Stale shards are only replaced once all of them have been recounted, so that if a
+            // recount throws, they all keep their old members and the changes, and are found
+            // stale again next time
+            Parallel::forEach(stale.size(),
+                [&members, &stale](size_t i)
                 {
-                    for (const auto& t : method->paramTypes)
-                    {
-                        visitMultiname(t);
-                    }
-                    visitMultiname(method->returnType);
-                    visitString(method->name);
-                    for (const auto& v : method->options)
+                    Shard& shard = members[stale[i]];
+                    for (const auto& script : shard.scripts)
                     {
-                        visitValue(v);
+                        shard.constants.visitScript(*script);
                     }
-                    for (const auto& n : method->paramNames)
+                    for (const auto& vclass : shard.classes)
                     {
-                        visitString(n);
+                        shard.constants.visitClass(*vclass);
                     }
-
-                    if (method->vbody)
+                    for (const auto& method : shard.methods)
                     {
-                        visitMethodBody(*method->vbody);
+                        shard.constants.visitMethod(*method);
                     }
-                }
-            }
-        }
+                });
 
-        void visitMethodBody(const ASASM::MethodBody& body)
-        {
-            if (body.method.lock() != nullptr)
+            for (size_t i : stale)
             {
-                for (const auto& instruction : body.instructions)
-                {
-                    for (size_t i = 0; i < OPCode_Info[(uint8_t)instruction.opcode].second.size();
-                         i++)
-                    {
-                        switch (OPCode_Info[(uint8_t)instruction.opcode].second[i])
-                        {
-                            case OPCodeArgumentType::Unknown:
-                                throw StringException(
-                                    "Don't know how to visit OP_" +
-                                    std::string(OPCode_Info[(uint8_t)instruction.opcode].first));
-
-                            case OPCodeArgumentType::ByteLiteral:
-                            case OPCodeArgumentType::UByteLiteral:
-                            case OPCodeArgumentType::IntLiteral:
-                            case OPCodeArgumentType::UIntLiteral:
-                                break;
-
-                            case OPCodeArgumentType::Int:
-                                visitInt(instruction.arguments[i].intv());
-                                break;
-                            case OPCodeArgumentType::UInt:
-                                visitUint(instruction.arguments[i].uintv());
-                                break;
-                            case OPCodeArgumentType::Double:
-                                visitDouble(instruction.arguments[i].doublev());
-                                break;
-                            case OPCodeArgumentType::String:
-                                visitString(instruction.arguments[i].stringv());
-                                break;
-                            case OPCodeArgumentType::Namespace:
-                                visitNamespace(instruction.arguments[i].namespacev());
-                                break;
-                            case OPCodeArgumentType::Multiname:
-                                visitMultiname(instruction.arguments[i].multinamev());
-                                break;
-                            case OPCodeArgumentType::Class:
-                                visitClass(instruction.arguments[i].classv());
-                                break;
-                            case OPCodeArgumentType::Method:
-                                visitMethod(instruction.arguments[i].methodv());
-                                break;
-
-                            case OPCodeArgumentType::JumpTarget:
-                            case OPCodeArgumentType::SwitchDefaultTarget:
-                            case OPCodeArgumentType::SwitchTargets:
-                                break;
-                            default:
-                                assert(false);
-                        }
-                    }
-                }
-
-                for (const auto& exception : body.exceptions)
-                {
-                    visitMultiname(exception.excType);
-                    visitMultiname(exception.varName);
-                }
-
-                visitMethod(body.method.lock());
-                visitTraits(body.traits);
+                shards[i] = std::move(members[i]);
             }
-        }
+            changed.clear();
 
-        void visitInstance(const ASASM::Instance& instance)
-        {
-            visitMultiname(instance.name);
-            visitMultiname(instance.superName);
-            visitNamespace(instance.protectedNs);
-            for (const auto& intf : instance.interfaces)
+            for (const auto& shard : shards)
             {
-                visitMultiname(intf);
+                merge(shard.constants);
             }
-            visitMethod(instance.iinit);
-            visitTraits(instance.traits);
         }
 
-        void run() override
-        {
-            for (const auto& script : as.scripts)
-            {
-                visitScript(*script);
-            }
-            for (const auto& vclass : as.orphanClasses)
-            {
-                visitClass(vclass);
-            }
-            for (const auto& vmethod : as.orphanMethods)
-            {
-                visitMethod(vmethod);
-            }
-        }
-
-        uint32_t getValueIndex(const ASASM::Value& value)
+        uint32_t getValueIndex(const ASASM::Value& value) const
         {
             switch (value.vkind)
             {
@@ -379,7 +316,7 @@ namespace ASASM
 
         void registerClassDependencies()
         {
-            std::map<ASASM::Multiname, std::shared_ptr<ASASM::Class>> classByName;
+            std::unordered_map<ASASM::Multiname, std::shared_ptr<ASASM::Class>> classByName;
 
             auto classObjects = classes.getPreliminaryValues();
             for (const auto& c : classObjects)
@@ -429,10 +366,21 @@ namespace ASASM
             }
         }
 
-        explicit AStoABC(const ASProgram& as) : ASTraitsVisitor(as)
+        explicit AStoABC(const ASProgram& as) : as(as) {}
+
+        // Marks a script or class as changed since the last lowering. Added and removed objects
+        // are noticed without this.
+        void invalidate(const ASASM::Script* script) { changed.emplace(script); }
+
+        void invalidate(const ASASM::Class* vclass) { changed.emplace(vclass); }
+
+        // Lowers the program into abc. Only the constants of changed objects are counted again
+        // after the first call, and method bodies whose pool indices all still refer to the same
+        // values are carried over. minimizePoolSizes enables a second lowering pass that reorders
+        // the constant pools to minimize the encoded size of the indices referring to them.
+        const SWFABC::ABCFile& lower(bool minimizePoolSizes = false)
         {
-            abc.minorVersion = as.minorVersion;
-            abc.majorVersion = as.majorVersion;
+            static_cast<ConstantCollector&>(*this) = ConstantCollector();
 
             run();
 
@@ -450,6 +398,42 @@ namespace ASASM
             classes.finalize();
             methods.finalize();
 
+            buildABC();
+
+            if (minimizePoolSizes && reorderPools())
+            {
+                buildABC();
+            }
+
+            return abc;
+        }
+
+        void buildABC()
+        {
+            // The previous bodies can be reused for the same method as long as every index they
+            // hold still refers to the same value
+            previousInts.compare(ints.values);
+            previousUints.compare(uints.values);
+            previousDoubles.compare(doubles.values);
+            previousStrings.compare(strings.values);
+            previousNamespaces.compare(namespaces.values);
+            previousMultinames.compare(multinames.values);
+            previousMetadatas.compare(metadatas.values);
+            previousClasses.compare(classes.values);
+            previousMethods.compare(methods.values);
+
+            std::vector<SWFABC::MethodBody> previousBodies = std::move(abc.bodies);
+            std::unordered_map<const ASASM::Method*, size_t> previousBodyIndices;
+            for (size_t i = 0; i < bodyOwners.size(); i++)
+            {
+                previousBodyIndices.emplace(bodyOwners[i].get(), i);
+            }
+            bodyOwners.clear();
+
+            abc              = SWFABC::ABCFile();
+            abc.minorVersion = as.minorVersion;
+            abc.majorVersion = as.majorVersion;
+
             abc.ints    = ints.values;
             abc.uints   = uints.values;
             abc.doubles = doubles.values;
@@ -537,8 +521,6 @@ namespace ASASM
                 }
             }
 
-            std::vector<ASASM::MethodBody> bodies;
-
             abc.methods.reserve(methods.values.size());
             for (size_t i = 0; i < methods.values.size(); i++)
             {
@@ -565,7 +547,7 @@ namespace ASASM
 
                 if (methods.values[i]->vbody)
                 {
-                    bodies.emplace_back(*methods.values[i]->vbody);
+                    bodyOwners.emplace_back(methods.values[i]);
                 }
             }
 
@@ -601,31 +583,361 @@ namespace ASASM
                     methods.get(as.scripts[i]->sinit), convertTraits(as.scripts[i]->traits));
             }
 
-            abc.bodies.reserve(bodies.size());
-            for (size_t i = 0; i < bodies.size(); i++)
+            // The pools are final, so the bodies can be lowered concurrently
+            abc.bodies.resize(bodyOwners.size());
+            Parallel::forEach(bodyOwners.size(),
+                [this, &previousBodies, &previousBodyIndices](size_t i)
+                {
+                    if (auto found = previousBodyIndices.find(bodyOwners[i].get());
+                        found != previousBodyIndices.end() &&
+                        isReusable(previousBodies[found->second]))
+                    {
+                        abc.bodies[i] = std::move(previousBodies[found->second]);
+                    }
+                    else
+                    {
+                        convertBody(*bodyOwners[i]->vbody, abc.bodies[i]);
+                    }
+                });
+
+            previousInts.values       = ints.values;
+            previousUints.values      = uints.values;
+            previousDoubles.values    = doubles.values;
+            previousStrings.values    = strings.values;
+            previousNamespaces.values = namespaces.values;
+            previousMultinames.values = multinames.values;
+            previousMetadatas.values  = metadatas.values;
+            previousClasses.values    = classes.values;
+            previousMethods.values    = methods.values;
+        }
+
+        // Calls f(pool, index) for the pool index held by a value of the given kind, if any
+        template <typename F>
+        static void forValueIndex(ABCType kind, uint32_t index, F&& f)
+        {
+            switch (kind)
+            {
+                case ABCType::Integer:
+                    return f(Pool::Int, index);
+                case ABCType::UInteger:
+                    return f(Pool::UInt, index);
+                case ABCType::Double:
+                    return f(Pool::Double, index);
+                case ABCType::Utf8:
+                    return f(Pool::String, index);
+                case ABCType::Namespace:
+                case ABCType::PackageNamespace:
+                case ABCType::PackageInternalNs:
+                case ABCType::ProtectedNamespace:
+                case ABCType::ExplicitNamespace:
+                case ABCType::StaticProtectedNs:
+                case ABCType::PrivateNamespace:
+                    return f(Pool::Namespace, index);
+                default:
+                    return;
+            }
+        }
+
+        // Calls f(pool, index) for every pool index ABCWriter writes for these traits
+        template <typename F>
+        static void forEachIndex(const std::vector<SWFABC::TraitsInfo>& traits, F&& f)
+        {
+            for (const auto& t : traits)
+            {
+                f(Pool::Multiname, t.name);
+                switch (t.kind())
+                {
+                    case TraitKind::Slot:
+                    case TraitKind::Const:
+                        f(Pool::Multiname, t.Slot.typeName);
+                        if (t.Slot.vindex != 0)
+                        {
+                            forValueIndex(t.Slot.vkind, t.Slot.vindex, f);
+                        }
+                        break;
+                    case TraitKind::Class:
+                        f(Pool::Class, t.Class.classi);
+                        break;
+                    case TraitKind::Function:
+                        f(Pool::Method, t.Function.functioni);
+                        break;
+                    case TraitKind::Getter:
+                    case TraitKind::Setter:
+                    case TraitKind::Method:
+                        f(Pool::Method, t.Method.method);
+                        break;
+                    default:
+                        break;
+                }
+                if (t.attr() & (uint8_t)TraitAttribute::Metadata)
+                {
+                    for (uint32_t md : t.metadata)
+                    {
+                        f(Pool::Metadata, md);
+                    }
+                }
+            }
+        }
+
+        // Calls f(pool, index) for every pool index ABCWriter writes for this body
+        template <typename F>
+        static void forEachIndex(const SWFABC::MethodBody& body, F&& f)
+        {
+            f(Pool::Method, body.method);
+            for (const auto& instruction : body.instructions)
+            {
+                for (size_t i = 0; i < instruction.arguments.size(); i++)
+                {
+                    switch (OPCode_Info[(uint8_t)instruction.opcode].second[i])
+                    {
+                        case OPCodeArgumentType::Int:
+                            f(Pool::Int, instruction.arguments[i].index());
+                            break;
+                        case OPCodeArgumentType::UInt:
+                            f(Pool::UInt, instruction.arguments[i].index());
+                            break;
+                        case OPCodeArgumentType::Double:
+                            f(Pool::Double, instruction.arguments[i].index());
+                            break;
+                        case OPCodeArgumentType::String:
+                            f(Pool::String, instruction.arguments[i].index());
+                            break;
+                        case OPCodeArgumentType::Namespace:
+                            f(Pool::Namespace, instruction.arguments[i].index());
+                            break;
+                        case OPCodeArgumentType::Multiname:
+                            f(Pool::Multiname, instruction.arguments[i].index());
+                            break;
+                        case OPCodeArgumentType::Class:
+                            f(Pool::Class, instruction.arguments[i].index());
+                            break;
+                        case OPCodeArgumentType::Method:
+                            f(Pool::Method, instruction.arguments[i].index());
+                            break;
+                        default:
+                            break;
+                    }
+                }
+            }
+            for (const auto& exception : body.exceptions)
+            {
+                f(Pool::Multiname, exception.excType);
+                f(Pool::Multiname, exception.varName);
+            }
+            forEachIndex(body.traits, f);
+        }
+
+        // Whether every index in a body from the previous buildABC still refers to the same value.
+        // Only reads the pools; safe to call concurrently.
+        bool isReusable(const SWFABC::MethodBody& body) const
+        {
+            bool ret = true;
+            forEachIndex(body,
+                [this, &ret](Pool pool, uint32_t index)
+                {
+                    switch (pool)
+                    {
+                        case Pool::Int:
+                            ret = ret && previousInts.isUnchanged(index);
+                            break;
+                        case Pool::UInt:
+                            ret = ret && previousUints.isUnchanged(index);
+                            break;
+                        case Pool::Double:
+                            ret = ret && previousDoubles.isUnchanged(index);
+                            break;
+                        case Pool::String:
+                            ret = ret && previousStrings.isUnchanged(index);
+                            break;
+                        case Pool::Namespace:
+                            ret = ret && previousNamespaces.isUnchanged(index);
+                            break;
+                        case Pool::Multiname:
+                            ret = ret && previousMultinames.isUnchanged(index);
+                            break;
+                        case Pool::Metadata:
+                            ret = ret && previousMetadatas.isUnchanged(index);
+                            break;
+                        case Pool::Class:
+                            ret = ret && previousClasses.isUnchanged(index);
+                            break;
+                        case Pool::Method:
+                            ret = ret && previousMethods.isUnchanged(index);
+                            break;
+                        default:
+                            ret = false;
+                            break;
+                    }
+                });
+            return ret;
+        }
+
+        // Counts every index written for each pool in abc, then reorders each pool by those counts.
+        // Returns whether any pool changed.
+        bool reorderPools()
+        {
+            std::array<std::vector<uint64_t>, (size_t)Pool::Count> refs;
+            refs[(size_t)Pool::Int].resize(abc.ints.size());
+            refs[(size_t)Pool::UInt].resize(abc.uints.size());
+            refs[(size_t)Pool::Double].resize(abc.doubles.size());
+            refs[(size_t)Pool::String].resize(abc.strings.size());
+            refs[(size_t)Pool::Namespace].resize(abc.namespaces.size());
+            refs[(size_t)Pool::NamespaceSet].resize(abc.namespaceSets.size());
+            refs[(size_t)Pool::Multiname].resize(abc.multinames.size());
+            refs[(size_t)Pool::Metadata].resize(abc.metadata.size());
+            refs[(size_t)Pool::Class].resize(abc.classes.size());
+            refs[(size_t)Pool::Method].resize(abc.methods.size());
+
+            const auto count = [&refs](Pool pool, uint32_t index)
+            {
+                if (index < refs[(size_t)pool].size())
+                {
+                    refs[(size_t)pool][index]++;
+                }
+            };
+
+            for (const auto& ns : abc.namespaces)
+            {
+                count(Pool::String, ns.name);
+            }
+            for (const auto& nsSet : abc.namespaceSets)
+            {
+                for (int32_t ns : nsSet)
+                {
+                    count(Pool::Namespace, ns);
+                }
+            }
+            for (const auto& m : abc.multinames)
+            {
+                switch (m.kind)
+                {
+                    case ABCType::QName:
+                    case ABCType::QNameA:
+                        count(Pool::Namespace, m.qname().ns);
+                        count(Pool::String, m.qname().name);
+                        break;
+                    case ABCType::RTQName:
+                    case ABCType::RTQNameA:
+                        count(Pool::String, m.rtqname().name);
+                        break;
+                    case ABCType::Multiname:
+                    case ABCType::MultinameA:
+                        count(Pool::String, m.multiname().name);
+                        count(Pool::NamespaceSet, m.multiname().nsSet);
+                        break;
+                    case ABCType::MultinameL:
+                    case ABCType::MultinameLA:
+                        count(Pool::NamespaceSet, m.multinamel().nsSet);
+                        break;
+                    case ABCType::TypeName:
+                        count(Pool::Multiname, m.Typename().name);
+                        for (uint32_t param : m.Typename().params)
+                        {
+                            count(Pool::Multiname, param);
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+            for (const auto& m : abc.methods)
             {
-                SWFABC::MethodBody& body = abc.bodies.emplace_back();
-                body.method              = methods.get(bodies[i].method.lock());
-                body.maxStack            = bodies[i].maxStack;
-                body.localCount          = bodies[i].localCount;
-                body.initScopeDepth      = bodies[i].initScopeDepth;
-                body.maxScopeDepth       = bodies[i].maxScopeDepth;
-                body.instructions.reserve(bodies[i].instructions.size());
-                for (size_t j = 0; j < bodies[i].instructions.size(); j++)
+                for (uint32_t paramType : m.paramTypes)
                 {
-                    body.instructions.emplace_back(convertInstruction(bodies[i].instructions[j]));
+                    count(Pool::Multiname, paramType);
                 }
-                body.exceptions.reserve(bodies[i].exceptions.size());
-                for (const auto& exception : bodies[i].exceptions)
+                count(Pool::Multiname, m.returnType);
+                count(Pool::String, m.name);
+                if (m.flags & (uint8_t)MethodFlags::HAS_OPTIONAL)
+                {
+                    for (const auto& option : m.options)
+                    {
+                        forValueIndex(option.kind, option.value, count);
+                    }
+                }
+                if (m.flags & (uint8_t)MethodFlags::HAS_PARAM_NAMES)
+                {
+                    for (uint32_t paramName : m.paramNames)
+                    {
+                        count(Pool::String, paramName);
+                    }
+                }
+            }
+            for (const auto& m : abc.metadata)
+            {
+                count(Pool::String, m.name);
+                for (const auto& [key, value] : m.data)
                 {
-                    body.exceptions.emplace_back(exception.from, exception.to, exception.target,
-                        multinames.get(exception.excType), multinames.get(exception.varName));
+                    count(Pool::String, key);
+                    count(Pool::String, value);
                 }
-                body.traits = convertTraits(bodies[i].traits);
             }
+            for (const auto& i : abc.instances)
+            {
+                count(Pool::Multiname, i.name);
+                count(Pool::Multiname, i.superName);
+                if (i.flags & (uint8_t)InstanceFlags::ProtectedNs)
+                {
+                    count(Pool::Namespace, i.protectedNs);
+                }
+                for (uint32_t iface : i.interfaces)
+                {
+                    count(Pool::Multiname, iface);
+                }
+                count(Pool::Method, i.iinit);
+                forEachIndex(i.traits, count);
+            }
+            for (const auto& c : abc.classes)
+            {
+                count(Pool::Method, c.cinit);
+                forEachIndex(c.traits, count);
+            }
+            for (const auto& s : abc.scripts)
+            {
+                count(Pool::Method, s.sinit);
+                forEachIndex(s.traits, count);
+            }
+            for (const auto& b : abc.bodies)
+            {
+                forEachIndex(b, count);
+            }
+
+            // Non-short-circuiting, so that every pool gets reordered
+            return ints.minimizeReferenceSize(refs[(size_t)Pool::Int]) |
+                   uints.minimizeReferenceSize(refs[(size_t)Pool::UInt]) |
+                   doubles.minimizeReferenceSize(refs[(size_t)Pool::Double]) |
+                   strings.minimizeReferenceSize(refs[(size_t)Pool::String]) |
+                   namespaces.minimizeReferenceSize(refs[(size_t)Pool::Namespace]) |
+                   namespaceSets.minimizeReferenceSize(refs[(size_t)Pool::NamespaceSet]) |
+                   multinames.minimizeReferenceSize(refs[(size_t)Pool::Multiname]) |
+                   metadatas.minimizeReferenceSize(refs[(size_t)Pool::Metadata]) |
+                   classes.minimizeReferenceSize(refs[(size_t)Pool::Class]) |
+                   methods.minimizeReferenceSize(refs[(size_t)Pool::Method]);
+        }
+
+        // Only reads the pools and abc's class and method counts; safe to call concurrently
+        void convertBody(const ASASM::MethodBody& from, SWFABC::MethodBody& body) const
+        {
+            body.method         = methods.get(from.method.lock());
+            body.maxStack       = from.maxStack;
+            body.localCount     = from.localCount;
+            body.initScopeDepth = from.initScopeDepth;
+            body.maxScopeDepth  = from.maxScopeDepth;
+            body.instructions.reserve(from.instructions.size());
+            for (const auto& instruction : from.instructions)
+            {
+                body.instructions.emplace_back(convertInstruction(instruction));
+            }
+            body.exceptions.reserve(from.exceptions.size());
+            for (const auto& exception : from.exceptions)
+            {
+                body.exceptions.emplace_back(exception.from, exception.to, exception.target,
+                    multinames.get(exception.excType), multinames.get(exception.varName));
+            }
+            body.traits = convertTraits(from.traits);
         }
 
-        std::vector<SWFABC::TraitsInfo> convertTraits(const std::vector<ASASM::Trait>& traits)
+        std::vector<SWFABC::TraitsInfo> convertTraits(const std::vector<ASASM::Trait>& traits) const
         {
             std::vector<SWFABC::TraitsInfo> ret;
             ret.reserve(traits.size());
@@ -671,7 +983,7 @@ namespace ASASM
             return ret;
         }
 
-        SWFABC::Instruction convertInstruction(const ASASM::Instruction& instruction)
+        SWFABC::Instruction convertInstruction(const ASASM::Instruction& instruction) const
         {
             SWFABC::Instruction ret;
             ret.opcode = instruction.opcode;
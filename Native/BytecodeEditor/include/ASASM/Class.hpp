@@ -3,6 +3,7 @@
 #include "ASASM/Instance.hpp"
 #include "ASASM/Method.hpp"
 #include "ASASM/Trait.hpp"
+#include "ASASM/TraitList.hpp"
 
 #include <memory>
 #include <vector>
@@ -12,11 +13,11 @@ namespace ASASM
     struct Class : public std::enable_shared_from_this<Class>
     {
         std::shared_ptr<Method> cinit;
-        std::vector<Trait> traits;
+        TraitList traits;
         Instance instance;
 
         Class(std::shared_ptr<Method>&& cinit, std::vector<Trait>&& traits, Instance&& instance)
-            : cinit(cinit), traits(traits), instance(instance)
+            : cinit(cinit), traits(std::move(traits)), instance(instance)
         {
         }
 
@@ -0,0 +1,361 @@
+#pragma once
+
+#include "ABC/ABCFile.hpp"
+#include "ASASM/Class.hpp"
+#include "ASASM/Metadata.hpp"
+#include "ASASM/Method.hpp"
+#include "ASASM/Multiname.hpp"
+#include "ASASM/Namespace.hpp"
+#include "ASASM/Script.hpp"
+#include "enums/OPCode.hpp"
+#include "utils/StringException.hpp"
+#include "utils/ValuePool.hpp"
+
+#include <cassert>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace ASASM
+{
+    // Counts the constants referenced by scripts, classes and methods into their pools. Only an
+    // object's own constants are visited: the classes and methods it refers to are not followed,
+    // so disjoint sets of objects can be collected separately (even concurrently) and merged.
+    class ConstantCollector
+    {
+    public:
+        ValuePool<int64_t> ints;
+        ValuePool<uint64_t> uints;
+        ValuePool<double> doubles;
+        ValuePool<std::optional<std::string>> strings;
+        ValuePool<ASASM::Namespace> namespaces;
+        ValuePool<std::vector<ASASM::Namespace>> namespaceSets;
+        ValuePool<ASASM::Multiname> multinames;
+        ValuePool<ASASM::Metadata, false> metadatas;
+        ValuePool<std::shared_ptr<ASASM::Class>, false> classes;
+        ValuePool<std::shared_ptr<ASASM::Method>, false> methods;
+
+    private:
+        // When unset, constants made of other constants (namespaces, namespace sets, multinames
+        // and metadata) are counted without visiting their parts. merge then visits the parts of
+        // each distinct one exactly once, as a single whole-program pass would.
+        bool expandComposites;
+
+    public:
+        explicit ConstantCollector(bool expandComposites = true)
+            : expandComposites(expandComposites)
+        {
+        }
+
+        void visitInt(int64_t v) { ints.add(v); }
+
+        void visitUint(uint64_t v) { uints.add(v); }
+
+        void visitDouble(double v) { doubles.add(v); }
+
+        void visitString(const std::optional<std::string>& v) { strings.add(v); }
+
+        void visitNamespace(const Namespace& ns)
+        {
+            if (namespaces.add(ns) && expandComposites)
+            {
+                if (ns.kind != ABCType::Void)
+                {
+                    visitString(ns.name);
+                }
+            }
+        }
+
+        void visitNamespaceSet(const std::vector<ASASM::Namespace>& nsSet)
+        {
+            if (namespaceSets.add(nsSet) && expandComposites)
+            {
+                for (const auto& ns : nsSet)
+                {
+                    visitNamespace(ns);
+                }
+            }
+        }
+
+        void visitMultiname(const ASASM::Multiname& multiname)
+        {
+            if (!expandComposites)
+            {
+                multinames.add(multiname);
+                return;
+            }
+
+            if (multinames.notAdded(multiname))
+            {
+                if (multiname.kind != ABCType::Void)
+                {
+                    switch (multiname.kind)
+                    {
+                        case ABCType::QName:
+                        case ABCType::QNameA:
+                            visitNamespace(multiname.qname().ns);
+                            visitString(multiname.qname().name);
+                            break;
+                        case ABCType::RTQName:
+                        case ABCType::RTQNameA:
+                            visitString(multiname.rtqname().name);
+                            break;
+                        case ABCType::RTQNameL:
+                        case ABCType::RTQNameLA:
+                            break;
+                        case ABCType::Multiname:
+                        case ABCType::MultinameA:
+                            visitString(multiname.multiname().name);
+                            visitNamespaceSet(multiname.multiname().nsSet);
+                            break;
+                        case ABCType::MultinameL:
+                        case ABCType::MultinameLA:
+                            visitNamespaceSet(multiname.multinamel().nsSet);
+                            break;
+                        case ABCType::TypeName:
+                            visitMultiname(multiname.Typename().name());
+                            for (const auto& param : multiname.Typename().params())
+                            {
+                                visitMultiname(param);
+                            }
+                            break;
+                        default:
+                            throw StringException("Unknown multiname kind");
+                    }
+                }
+
+                bool unrecursiveMultiname = multinames.add(multiname);
+                (void)unrecursiveMultiname;
+                assert(unrecursiveMultiname);
+            }
+        }
+
+        void visitMetadata(const ASASM::Metadata& metadata)
+        {
+            if (metadatas.add(metadata) && expandComposites)
+            {
+                if (!metadata.data.empty())
+                {
+                    visitString(metadata.name);
+                    for (const auto& md : metadata.data)
+                    {
+                        visitString(md.first);
+                        visitString(md.second);
+                    }
+                }
+            }
+        }
+
+        void visitValue(const ASASM::Value& value)
+        {
+            switch (value.vkind)
+            {
+                case ABCType::Integer:
+                    visitInt(value.vint());
+                    break;
+                case ABCType::UInteger:
+                    visitUint(value.vuint());
+                    break;
+                case ABCType::Double:
+                    visitDouble(value.vdouble());
+                    break;
+                case ABCType::Utf8:
+                    visitString(value.vstring());
+                    break;
+                case ABCType::Namespace:
+                case ABCType::PackageNamespace:
+                case ABCType::PackageInternalNs:
+                case ABCType::ProtectedNamespace:
+                case ABCType::ExplicitNamespace:
+                case ABCType::StaticProtectedNs:
+                case ABCType::PrivateNamespace:
+                    visitNamespace(value.vnamespace());
+                    break;
+                case ABCType::True:
+                case ABCType::False:
+                case ABCType::Null:
+                case ABCType::Undefined:
+                    break;
+                default:
+                    throw StringException("Unknown value type");
+            }
+        }
+
+        void visitTraits(const std::vector<ASASM::Trait>& traits)
+        {
+            for (const auto& trait : traits)
+            {
+                visitTrait(trait);
+            }
+        }
+
+        void visitTrait(const ASASM::Trait& trait)
+        {
+            visitMultiname(trait.name);
+            switch (trait.kind)
+            {
+                case TraitKind::Slot:
+                case TraitKind::Const:
+                    visitMultiname(trait.vSlot().typeName);
+                    visitValue(trait.vSlot().value);
+                    break;
+                case TraitKind::Class:
+                case TraitKind::Function:
+                case TraitKind::Method:
+                case TraitKind::Getter:
+                case TraitKind::Setter:
+                    break;
+                default:
+                    throw StringException("Unknown trait kind");
+            }
+            for (const auto& md : trait.metadata)
+            {
+                visitMetadata(md);
+            }
+        }
+
+        void visitScript(const ASASM::Script& script) { visitTraits(script.traits); }
+
+        void visitClass(const ASASM::Class& vclass)
+        {
+            visitTraits(vclass.traits);
+            visitInstance(vclass.instance);
+        }
+
+        void visitInstance(const ASASM::Instance& instance)
+        {
+            visitMultiname(instance.name);
+            visitMultiname(instance.superName);
+            visitNamespace(instance.protectedNs);
+            for (const auto& intf : instance.interfaces)
+            {
+                visitMultiname(intf);
+            }
+            visitTraits(instance.traits);
+        }
+
+        void visitMethod(const ASASM::Method& method)
+        {
+            for (const auto& t : method.paramTypes)
+            {
+                visitMultiname(t);
+            }
+            visitMultiname(method.returnType);
+            visitString(method.name);
+            for (const auto& v : method.options)
+            {
+                visitValue(v);
+            }
+            for (const auto& n : method.paramNames)
+            {
+                visitString(n);
+            }
+
+            if (method.vbody)
+            {
+                visitMethodBody(*method.vbody);
+            }
+        }
+
+        void visitMethodBody(const ASASM::MethodBody& body)
+        {
+            if (body.method.lock() != nullptr)
+            {
+                for (const auto& instruction : body.instructions)
+                {
+                    for (size_t i = 0; i < OPCode_Info[(uint8_t)instruction.opcode].second.size();
+                         i++)
+                    {
+                        switch (OPCode_Info[(uint8_t)instruction.opcode].second[i])
+                        {
+                            case OPCodeArgumentType::Unknown:
+                                throw StringException(
+                                    "Don't know how to visit OP_" +
+                                    std::string(OPCode_Info[(uint8_t)instruction.opcode].first));
+
+                            case OPCodeArgumentType::ByteLiteral:
+                            case OPCodeArgumentType::UByteLiteral:
+                            case OPCodeArgumentType::IntLiteral:
+                            case OPCodeArgumentType::UIntLiteral:
+                                break;
+
+                            case OPCodeArgumentType::Int:
+                                visitInt(instruction.arguments[i].intv());
+                                break;
+                            case OPCodeArgumentType::UInt:
+                                visitUint(instruction.arguments[i].uintv());
+                                break;
+                            case OPCodeArgumentType::Double:
+                                visitDouble(instruction.arguments[i].doublev());
+                                break;
+                            case OPCodeArgumentType::String:
+                                visitString(instruction.arguments[i].stringv());
+                                break;
+                            case OPCodeArgumentType::Namespace:
+                                visitNamespace(instruction.arguments[i].namespacev());
+                                break;
+                            case OPCodeArgumentType::Multiname:
+                                visitMultiname(instruction.arguments[i].multinamev());
+                                break;
+
+                            case OPCodeArgumentType::Class:
+                            case OPCodeArgumentType::Method:
+                            case OPCodeArgumentType::JumpTarget:
+                            case OPCodeArgumentType::SwitchDefaultTarget:
+                            case OPCodeArgumentType::SwitchTargets:
+                                break;
+                            default:
+                                assert(false);
+                        }
+                    }
+                }
+
+                for (const auto& exception : body.exceptions)
+                {
+                    visitMultiname(exception.excType);
+                    visitMultiname(exception.varName);
+                }
+
+                visitTraits(body.traits);
+            }
+        }
+
+        // Adds the constants counted by a collector that didn't expand composites. Class and
+        // method pools are left alone.
+        void merge(const ConstantCollector& shard)
+        {
+            const auto mergeCounts = [](auto& pool, const auto& other)
+            {
+                for (const auto& entry : other.getEntries())
+                {
+                    pool.add(entry.value, entry.hits);
+                }
+            };
+            const auto mergeComposites = [](auto& pool, const auto& other, const auto& visit)
+            {
+                for (const auto& entry : other.getEntries())
+                {
+                    visit(entry.value);
+                    if (entry.hits > 1)
+                    {
+                        pool.add(entry.value, entry.hits - 1);
+                    }
+                }
+            };
+
+            mergeCounts(ints, shard.ints);
+            mergeCounts(uints, shard.uints);
+            mergeCounts(doubles, shard.doubles);
+            mergeCounts(strings, shard.strings);
+            mergeComposites(namespaces, shard.namespaces,
+                [this](const ASASM::Namespace& v) { visitNamespace(v); });
+            mergeComposites(namespaceSets, shard.namespaceSets,
+                [this](const std::vector<ASASM::Namespace>& v) { visitNamespaceSet(v); });
+            mergeComposites(multinames, shard.multinames,
+                [this](const ASASM::Multiname& v) { visitMultiname(v); });
+            mergeComposites(metadatas, shard.metadatas,
+                [this](const ASASM::Metadata& v) { visitMetadata(v); });
+        }
+    };
+}
@@ -4,6 +4,7 @@
 #include "ASASM/Multiname.hpp"
 #include "ASASM/Namespace.hpp"
 #include "ASASM/Trait.hpp"
+#include "ASASM/TraitList.hpp"
 
 #include <memory>
 #include <stdint.h>
@@ -19,7 +20,7 @@ namespace ASASM
         Namespace protectedNs;
         std::vector<Multiname> interfaces;
         std::shared_ptr<Method> iinit;
-        std::vector<Trait> traits;
+        TraitList traits;
 
         auto operator<=>(const Instance&) const noexcept = default;
         bool operator==(const Instance&) const noexcept  = default;
@@ -205,9 +205,55 @@ namespace ASASM
 
         bool operator==(const Multiname&) const noexcept = default;
 
+        // Consistent with operator==, so Multinames can key unordered containers
+        size_t hash() const noexcept
+        {
+            static constexpr auto hashNsSet = [](const std::vector<Namespace>& nsSet)
+            {
+                size_t ret = nsSet.size();
+                for (const auto& ns : nsSet)
+                {
+                    ret = hash_combine(ret, std::hash<Namespace>{}(ns));
+                }
+                return ret;
+            };
+
+            size_t ret = hash_combine(std::hash<ABCType>{}(kind), data.index());
+            switch (data.index())
+            {
+                case 1:
+                    ret = hash_combine(ret, std::hash<Namespace>{}(qname().ns));
+                    return hash_combine(ret, std::hash<std::optional<std::string>>{}(qname().name));
+                case 2:
+                    return hash_combine(
+                        ret, std::hash<std::optional<std::string>>{}(rtqname().name));
+                case 4:
+                    ret = hash_combine(ret, hashNsSet(multiname().nsSet));
+                    return hash_combine(
+                        ret, std::hash<std::optional<std::string>>{}(multiname().name));
+                case 5:
+                    return hash_combine(ret, hashNsSet(multinamel().nsSet));
+                case 6:
+                    ret = hash_combine(ret, Typename().name().hash());
+                    for (const auto& param : Typename().params())
+                    {
+                        ret = hash_combine(ret, param.hash());
+                    }
+                    return ret;
+                default:
+                    return ret;
+            }
+        }
+
     private:
         std::variant<std::monostate, _QName, _RTQName, _RTQNameL, _Multiname, _MultinameL,
             _Typename>
             data;
     };
 }
+
+template <>
+struct std::hash<ASASM::Multiname>
+{
+    size_t operator()(const ASASM::Multiname& v) const noexcept { return v.hash(); }
+};
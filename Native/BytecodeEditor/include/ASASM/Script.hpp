@@ -2,6 +2,7 @@
 
 #include "ASASM/Method.hpp"
 #include "ASASM/Trait.hpp"
+#include "ASASM/TraitList.hpp"
 
 #include <memory>
 #include <vector>
@@ -11,7 +12,7 @@ namespace ASASM
     struct Script
     {
         std::shared_ptr<Method> sinit;
-        std::vector<Trait> traits;
+        TraitList traits;
 
         auto operator<=>(const Script&) const noexcept = default;
         bool operator==(const Script&) const noexcept  = default;
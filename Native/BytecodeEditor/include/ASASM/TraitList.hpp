@@ -0,0 +1,204 @@
+#pragma once
+
+#include "ASASM/Multiname.hpp"
+#include "ASASM/Trait.hpp"
+#include "utils/SmallTrivialVector.hpp"
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace ASASM
+{
+    // An ordered list of traits with a by-name lookup index attached. The vector order is what
+    // gets serialized; the index is built on the first lookup and then kept up to date by the
+    // mutating members, which are the only way to change the list. As the first lookup writes the
+    // index, find() must not race with anything else on the same list, even though it is const.
+    class TraitList
+    {
+    public:
+        // Indices of every trait with a given name, in list order. Normally one trait, or a
+        // getter/setter pair; a third slot is kept so that malformed lists can be detected.
+        using Matches = SmallTrivialVector<size_t, 3>;
+
+    private:
+        std::vector<Trait> traits;
+
+        mutable std::unordered_map<Multiname, Matches> index;
+        // Names with more traits than Matches can hold. They are left out of the index and looked
+        // up by scanning the list instead.
+        mutable std::unordered_set<Multiname> overflowed;
+        mutable bool indexed = false;
+
+        static Matches without(const Matches& matches, size_t position)
+        {
+            Matches ret(0);
+            for (size_t match : matches)
+            {
+                if (match != position)
+                {
+                    ret.push_back(match);
+                }
+            }
+            return ret;
+        }
+
+        // Returns false if the name already has as many matches as can be tracked
+        static bool with(Matches& matches, size_t position)
+        {
+            if (matches.size() == matches.capacity())
+            {
+                return false;
+            }
+
+            Matches ret(0);
+            bool added = false;
+            for (size_t match : matches)
+            {
+                if (!added && position < match)
+                {
+                    ret.push_back(position);
+                    added = true;
+                }
+                ret.push_back(match);
+            }
+            if (!added)
+            {
+                ret.push_back(position);
+            }
+            matches = ret;
+            return true;
+        }
+
+        void add(const Multiname& name, size_t position) const
+        {
+            if (!overflowed.empty() && overflowed.contains(name))
+            {
+                return;
+            }
+
+            if (auto found = index.try_emplace(name, size_t(0)).first;
+                !with(found->second, position))
+            {
+                index.erase(found);
+                overflowed.emplace(name);
+            }
+        }
+
+        void buildIndex() const
+        {
+            index.clear();
+            overflowed.clear();
+            index.reserve(traits.size());
+            indexed = true;
+            for (size_t i = 0; i < traits.size(); i++)
+            {
+                add(traits[i].name, i);
+            }
+        }
+
+        void unindex(const Multiname& name, size_t position)
+        {
+            if (auto found = index.find(name); found != index.end())
+            {
+                found->second = without(found->second, position);
+                if (found->second.size() == 0)
+                {
+                    index.erase(found);
+                }
+            }
+        }
+
+    public:
+        TraitList() = default;
+
+        TraitList(std::vector<Trait> traits) : traits(std::move(traits)) {}
+
+        operator const std::vector<Trait>&() const { return traits; }
+
+        [[nodiscard]] size_t size() const { return traits.size(); }
+
+        [[nodiscard]] bool empty() const { return traits.empty(); }
+
+        [[nodiscard]] const Trait& operator[](size_t i) const { return traits[i]; }
+
+        [[nodiscard]] auto begin() const { return traits.begin(); }
+
+        [[nodiscard]] auto end() const { return traits.end(); }
+
+        void reserve(size_t size) { traits.reserve(size); }
+
+        [[nodiscard]] Matches find(const Multiname& name) const
+        {
+            if (!indexed)
+            {
+                buildIndex();
+            }
+
+            if (!overflowed.empty() && overflowed.contains(name))
+            {
+                Matches ret(0);
+                for (size_t i = 0; i < traits.size() && ret.size() < ret.capacity(); i++)
+                {
+                    if (traits[i].name == name)
+                    {
+                        ret.push_back(i);
+                    }
+                }
+                return ret;
+            }
+
+            if (auto found = index.find(name); found != index.end())
+            {
+                return found->second;
+            }
+            return Matches(0);
+        }
+
+        const Trait& emplace_back(Trait&& trait)
+        {
+            if (indexed)
+            {
+                add(trait.name, traits.size());
+            }
+            return traits.emplace_back(std::move(trait));
+        }
+
+        void replace(size_t position, Trait&& trait)
+        {
+            if (indexed && traits[position].name != trait.name)
+            {
+                unindex(traits[position].name, position);
+                add(trait.name, position);
+            }
+            traits[position] = std::move(trait);
+        }
+
+        void erase(size_t position)
+        {
+            if (indexed)
+            {
+                unindex(traits[position].name, position);
+                // Everything after the erased trait moves down by one
+                for (size_t i = position + 1; i < traits.size(); i++)
+                {
+                    if (auto found = index.find(traits[i].name); found != index.end())
+                    {
+                        for (size_t& match : found->second)
+                        {
+                            if (match == i)
+                            {
+                                match--;
+                            }
+                        }
+                    }
+                }
+            }
+            traits.erase(traits.begin() + position);
+        }
+
+        auto operator<=>(const TraitList& other) const noexcept { return traits <=> other.traits; }
+
+        bool operator==(const TraitList& other) const noexcept { return traits == other.traits; }
+    };
+}
@@ -17,38 +17,79 @@
 #include "enums/InstanceFlags.hpp"
 #include "enums/MethodFlags.hpp"
 #include "enums/TraitAttribute.hpp"
+#include "utils/ByteScan.hpp"
+#include "utils/MethodBodyCache.hpp"
+#include "utils/Parallel.hpp"
+#include "utils/ProjectArchive.hpp"
 #include "utils/StringException.hpp"
 
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <deque>
+#include <exception>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
 class Assembler
 {
+public:
+    // Gives the contents of the named file, or nothing if there's no such file
+    using SourceLookup = std::function<std::optional<std::string_view>(const std::string&)>;
+
+    class ParseCache;
+
 private:
-    const std::unordered_map<std::string, std::string>& strings;
+    const SourceLookup& sources;
     bool includeDebugInstructions;
 
     static constexpr char addUniqueMethod[] = "method";
     static constexpr char addUniqueClass[]  = "class";
     static constexpr char addUniqueLabel[]  = "label";
 
-    struct SourceFile : public std::enable_shared_from_this<SourceFile>
+    // Files are never copied: data views the caller's sources, text kept alive in
+    // Assembler::texts, an enclosing file's arguments or the file's own text. The files themselves
+    // live in Assembler::files, which lets a finished file go once no position refers to it.
+    struct SourceFile
     {
         std::string name;
         std::vector<std::string> arguments;
-        std::string data;
+        // Text made up for this file alone (#mixin and #call bodies, string literals)
+        std::string text;
+        std::string_view data;
 
         bool isVirtual() { return data != ""; }
 
-        std::shared_ptr<SourceFile> parent;
+        SourceFile* parent = nullptr;
 
         size_t filePosition;
+        // Positions still referring to this file
+        size_t pins = 0;
 
         SourceFile(std::string_view name, std::string_view data,
-            const std::vector<std::string>& arguments = {})
-            : name(name), arguments(arguments), data(data), filePosition(0)
+            std::vector<std::string>&& arguments = {})
+            : name(name), arguments(std::move(arguments)), data(data), filePosition(0)
+        {
+            if (data.empty())
+            {
+                throw StringException("Empty source file");
+            }
+        }
+
+        SourceFile(
+            std::string_view name, std::string&& text, std::vector<std::string>&& arguments = {})
+            : name(name),
+              arguments(std::move(arguments)),
+              text(std::move(text)),
+              data(this->text),
+              filePosition(0)
         {
             if (data.empty())
             {
@@ -56,19 +97,27 @@ private:
             }
         }
 
+        SourceFile(const SourceFile&)            = delete;
+        SourceFile& operator=(const SourceFile&) = delete;
+
         struct Position
         {
-            std::shared_ptr<SourceFile> file;
+            SourceFile* file;
             size_t offset;
 
-            const std::shared_ptr<SourceFile>& load() const
+            SourceFile* load() const
             {
                 file->filePosition = offset;
                 return file;
             }
         };
 
-        Position position() { return Position(shared_from_this(), filePosition); }
+        // Keeps the file alive until unpin
+        Position position()
+        {
+            pins++;
+            return Position(this, filePosition);
+        }
 
         std::string positionStr()
         {
@@ -91,14 +140,21 @@ private:
             return name + "(???)";
         }
 
-        char front() { return data[filePosition]; }
+        char front() { return filePosition < data.size() ? data[filePosition] : '\0'; }
 
         void popFront() { filePosition++; }
     };
 
     using Position = SourceFile::Position;
 
-    std::shared_ptr<SourceFile> currentFile;
+    // Pushed and popped like a stack, except that popped files stay while positions refer to them
+    std::deque<SourceFile> files;
+    // Text made up during assembly that outlives the file it came from (variables) and that files
+    // may view
+    std::deque<std::string> texts;
+    SourceFile* currentFile = nullptr;
+
+    std::string_view keep(std::string&& text) { return texts.emplace_back(std::move(text)); }
 
     void skipWhitespace()
     {
@@ -111,7 +167,8 @@ private:
             }
             if (c == ' ' || c == '\r' || c == '\n' || c == '\t')
             {
-                skipChar();
+                currentFile->filePosition = ByteScan::skip<' ', '\r', '\n', '\t'>(
+                    currentFile->data, currentFile->filePosition);
             }
             else if (c == '#')
             {
@@ -123,11 +180,9 @@ private:
             }
             else if (c == ';')
             {
-                do
-                {
-                    skipChar();
-                }
-                while (peekChar() != '\n');
+                // A comment at the end of a file ends with it
+                currentFile->filePosition =
+                    ByteScan::find<'\n'>(currentFile->data, currentFile->filePosition);
             }
             else
             {
@@ -136,42 +191,86 @@ private:
         }
     }
 
-    std::unordered_map<std::string, std::string> vars;
+    std::unordered_map<std::string, std::string_view> vars;
     std::vector<std::string> namespaceLabels;
     uint32_t sourceVersion = 1;
 
+    // An #include at the top level of main.asasm that's assembled on its own, along with where
+    // its results go in the program and the state it starts in
+    struct DeferredInclude
+    {
+        std::string name;
+        size_t scripts, orphanClasses, orphanMethods;
+        std::unordered_map<std::string, std::string_view> vars;
+        uint32_t sourceVersion;
+        size_t namespaceLabels;
+        Position where;
+    };
+
+    // What this assembler is given of an assembly: all of it, or in a parallel one, either
+    // main.asasm, whose top-level #includes are deferred, or one of those includes
+    enum class Part
+    {
+        Whole,
+        Main,
+        Include,
+    } part = Part::Whole;
+
+    // Thrown where a parallel assembly can't vouch for giving what a serial one would, to have
+    // the program assembled serially instead
+    struct NeedsSerialAssembly
+    {
+    };
+
+    // Set while main.asasm's readProgram expects a program field
+    ASASM::ASProgram* deferringInto = nullptr;
+    // Set while readProgram expects a program field. An include assembled on its own has to end
+    // there, or it isn't a whole number of program fields.
+    bool atProgramField = false;
+    std::vector<DeferredInclude> deferredIncludes;
+
     void handlePreprocessor()
     {
         skipChar(); // #
-        std::string word = readWord();
+        std::string_view word = readWord();
 
         if (word == "mixin")
         {
-            pushFile(std::make_shared<SourceFile>("#mixin", readRealString()));
+            pushFile("#mixin", readRealString());
         }
         else if (word == "call")
         {
-            auto rsLambda = [this] { return readString(); };
-            pushFile(std::make_shared<SourceFile>("#call", readRealString(),
-                readList<'(', ')', false>([this] { return readRealString(); })));
+            std::string text = readRealString();
+            pushFile("#call", std::move(text),
+                readList<'(', ')', false>([this] { return readRealString(); }));
         }
         else if (word == "include")
         {
             std::string s = readRealString();
-            pushFile(std::make_shared<SourceFile>(s, strings.at(s)));
+            if (deferringInto && currentFile->parent == nullptr)
+            {
+                deferredIncludes.emplace_back(std::move(s), deferringInto->scripts.size(),
+                    deferringInto->orphanClasses.size(), deferringInto->orphanMethods.size(), vars,
+                    sourceVersion, namespaceLabels.size(), currentFile->position());
+            }
+            else
+            {
+                pushFile(s, source(s));
+            }
         }
         else if (word == "get")
         {
             std::string s = readRealString();
-            pushFile(std::make_shared<SourceFile>(s, toStringLiteral(strings.at(s))));
+            pushFile(s, toStringLiteral(source(s)));
         }
         else if (word == "set")
         {
-            vars[readWord()] = readRealString();
+            std::string name(readWord());
+            vars[std::move(name)] = keep(readRealString());
         }
         else if (word == "unset")
         {
-            vars.erase(readWord());
+            vars.erase(std::string(readWord()));
         }
         else if (word == "privatens")
         {
@@ -193,7 +292,7 @@ private:
         else
         {
             backpedal(word.size());
-            throw StringException("Unknown preprocessor declaration: " + word);
+            throw StringException("Unknown preprocessor declaration: " + std::string(word));
         }
     }
 
@@ -220,7 +319,7 @@ private:
         }
         if (name[0] >= '1' && name[0] <= '9')
         {
-            for (std::shared_ptr<SourceFile> f = currentFile; f != nullptr; f = f->parent)
+            for (SourceFile* f = currentFile; f != nullptr; f = f->parent)
             {
                 if (!f->arguments.empty())
                 {
@@ -229,9 +328,15 @@ private:
                     {
                         throw StringException("Argument index out of bounds");
                     }
-                    pushFile(std::make_shared<SourceFile>(
-                        '$' + name, asStringLiteral ? toStringLiteral(f->arguments[index])
-                                                    : f->arguments[index]));
+                    const std::string& argument = f->arguments[index];
+                    if (asStringLiteral)
+                    {
+                        pushFile('$' + name, toStringLiteral(argument));
+                    }
+                    else
+                    {
+                        pushFile('$' + name, std::string_view(argument));
+                    }
                     return;
                 }
             }
@@ -243,37 +348,73 @@ private:
             {
                 throw StringException("Variable " + name + " is not defined");
             }
-            pushFile(std::make_shared<SourceFile>(
-                '$' + name, asStringLiteral ? toStringLiteral(vars.at(name)) : vars.at(name)));
+            if (asStringLiteral)
+            {
+                pushFile('$' + name, toStringLiteral(vars.at(name)));
+            }
+            else
+            {
+                pushFile('$' + name, vars.at(name));
+            }
         }
     }
 
-    static bool isWordChar(char c)
+    static constexpr std::array<bool, 256> wordChars = []
     {
-        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
-               c == '_' || c == '-' || c == '+' || c == '.';
-    }
+        std::array<bool, 256> ret{};
+        for (int c = 0; c < 256; c++)
+        {
+            ret[c] = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                     c == '_' || c == '-' || c == '+' || c == '.';
+        }
+        return ret;
+    }();
+
+    static bool isWordChar(char c) { return wordChars[(unsigned char)c]; }
 
-    std::string readWord()
+    // The word is a view into the current file, so it's only valid until the next read, which
+    // may leave that file behind
+    std::string_view readWord()
     {
         skipWhitespace();
-        if (!isWordChar(currentFile->front()))
+        const std::string_view data = currentFile->data;
+        const size_t start          = currentFile->filePosition;
+        size_t end                  = start;
+        while (end < data.size() && isWordChar(data[end]))
         {
-            // throw StringException("Word character expected");
-            return {};
+            end++;
         }
-        std::string ret;
-        while (true)
+        currentFile->filePosition = end;
+        return data.substr(start, end - start);
+    }
+
+    // Parses an integer the way strtoll/strtoull do with base 0: an optional sign, then hex after
+    // 0x, octal after 0, or decimal. Anything after the digits is ignored, and no digits at all
+    // give 0. Returns false if the magnitude doesn't fit in a uint64_t.
+    static bool parseInteger(std::string_view w, bool& negative, uint64_t& magnitude)
+    {
+        negative = false;
+        if (!w.empty() && (w[0] == '-' || w[0] == '+'))
         {
-            char c = currentFile->front();
-            if (!isWordChar(c))
-            {
-                break;
-            }
-            ret += c;
-            currentFile->popFront();
+            negative = w[0] == '-';
+            w.remove_prefix(1);
         }
-        return ret;
+
+        int base = 10;
+        if (w.size() > 2 && w[0] == '0' && (w[1] == 'x' || w[1] == 'X') &&
+            std::isxdigit((unsigned char)w[2]))
+        {
+            base = 16;
+            w.remove_prefix(2);
+        }
+        else if (w.size() > 1 && w[0] == '0')
+        {
+            base = 8;
+        }
+
+        magnitude         = 0;
+        const auto result = std::from_chars(w.data(), w.data() + w.size(), magnitude, base);
+        return result.ec != std::errc::result_out_of_range;
     }
 
     uint8_t fromHex(char x)
@@ -323,26 +464,46 @@ private:
         }
     }
 
-    void pushFile(std::shared_ptr<SourceFile> f)
+    template <typename... Args>
+    void pushFile(Args&&... args)
     {
-        f->parent   = currentFile;
-        currentFile = f;
+        SourceFile& f = files.emplace_back(std::forward<Args>(args)...);
+        f.parent      = currentFile;
+        currentFile   = &f;
     }
 
-    void setFile(std::shared_ptr<SourceFile> f) { currentFile = f; }
+    void setFile(SourceFile* f) { currentFile = f; }
 
     void popFile()
     {
+        if (part == Part::Include && currentFile &&
+            (!currentFile->parent || (!currentFile->parent->parent && !atProgramField)))
+        {
+            throw NeedsSerialAssembly{};
+        }
         if (!currentFile || !currentFile->parent)
         {
             throw StringException("Unexpected end of file");
         }
         currentFile = currentFile->parent;
+        releaseFiles();
     }
 
+    // Files after the current one have all been popped; those at the end that no position refers
+    // to any more are let go
+    void releaseFiles()
+    {
+        while (&files.back() != currentFile && files.back().pins == 0)
+        {
+            files.pop_back();
+        }
+    }
+
+    void unpin(const Position& position) { position.file->pins--; }
+
     void expectWord(std::string_view expected)
     {
-        std::string word = readWord();
+        std::string_view word = readWord();
         if (word != expected)
         {
             backpedal(word.size());
@@ -444,7 +605,7 @@ private:
 
     static ABCType toABCType(std::string_view name)
     {
-        auto found = ABCTypeMap.Find(name.data());
+        auto found = ABCTypeMap.Find(name);
         if (!found)
         {
             throw StringException("Unknown ABCType " + std::string(name));
@@ -553,12 +714,12 @@ private:
     template <typename T>
     uint8_t readFlag(const T& BiMap)
     {
-        auto word  = readWord();
-        auto found = BiMap.Find(word.c_str());
+        std::string_view word = readWord();
+        auto found            = BiMap.Find(word);
         if (!found)
         {
             backpedal(word.size());
-            throw StringException("Unknown flag " + word);
+            throw StringException("Unknown flag " + std::string(word));
         }
         return (uint8_t)found->get();
     }
@@ -571,7 +732,7 @@ private:
             skipWhitespace();
             if (peekChar() != OPEN)
             {
-                std::string word = readWord();
+                std::string_view word = readWord();
                 if (word != "null")
                 {
                     backpedal(word.size());
@@ -609,42 +770,71 @@ private:
 
     int64_t readInt()
     {
-        const std::string w = readWord();
+        const std::string_view w = readWord();
         if (w == "null")
         {
             return SWFABC::ABCFile::NULL_INT;
         }
-        const int64_t ret = strtoll(w.c_str(), nullptr, 0);
-        if (ret < SWFABC::ABCFile::MIN_INT || ret > SWFABC::ABCFile::MAX_INT)
+        bool negative;
+        uint64_t magnitude;
+        if (!parseInteger(w, negative, magnitude) ||
+            magnitude > (negative ? uint64_t(-SWFABC::ABCFile::MIN_INT)
+                                  : uint64_t(SWFABC::ABCFile::MAX_INT)))
         {
             throw StringException("Int out of bounds");
         }
-        return ret;
+        return negative ? -int64_t(magnitude) : int64_t(magnitude);
     }
 
     uint64_t readUInt()
     {
-        const std::string w = readWord();
+        const std::string_view w = readWord();
         if (w == "null")
         {
             return SWFABC::ABCFile::NULL_UINT;
         }
-        const uint64_t ret = strtoull(w.c_str(), nullptr, 0);
-        if (ret > SWFABC::ABCFile::MAX_UINT)
+        bool negative;
+        uint64_t magnitude;
+        // Negative values wrap around, as with strtoull, so only -0 is in bounds
+        if (!parseInteger(w, negative, magnitude) || (negative && magnitude != 0) ||
+            magnitude > SWFABC::ABCFile::MAX_UINT)
         {
             throw StringException("UInt out of bounds");
         }
-        return ret;
+        return magnitude;
     }
 
     double readDouble()
     {
-        const std::string w = readWord();
-        if (w == "null")
+        const std::string_view word = readWord();
+        if (word == "null")
         {
             return SWFABC::ABCFile::NULL_DOUBLE;
         }
-        return strtod(w.c_str(), nullptr);
+        std::string_view w = word;
+
+        // from_chars takes neither a leading + nor a hex prefix, both of which strtod accepts
+        bool negative = false;
+        if (!w.empty() && (w[0] == '-' || w[0] == '+'))
+        {
+            negative = w[0] == '-';
+            w.remove_prefix(1);
+        }
+        std::chars_format format = std::chars_format::general;
+        if (w.size() > 2 && w[0] == '0' && (w[1] == 'x' || w[1] == 'X'))
+        {
+            format = std::chars_format::hex;
+            w.remove_prefix(2);
+        }
+
+        double ret = 0;
+        if (std::from_chars(w.data(), w.data() + w.size(), ret, format).ec ==
+            std::errc::result_out_of_range)
+        {
+            // Rare enough to leave to strtod, which gives infinities, subnormals and zeroes
+            return strtod(std::string(word).c_str(), nullptr);
+        }
+        return negative ? -ret : ret;
     }
 
     std::string readRealString()
@@ -654,7 +844,7 @@ private:
         {
             throw StringException("Null string found where real string expected");
         }
-        return *ret;
+        return std::move(*ret);
     }
 
     std::optional<std::string> readString()
@@ -663,7 +853,7 @@ private:
         char c = readSymbol();
         if (c != '"')
         {
-            std::string word = readWord();
+            std::string_view word = readWord();
             if (c == 'n' && word == "ull")
             {
                 return std::nullopt;
@@ -678,6 +868,13 @@ private:
         std::string ret;
         while (true)
         {
+            // Runs of plain characters are copied in one go
+            const std::string_view data = currentFile->data;
+            const size_t start          = currentFile->filePosition;
+            const size_t end            = ByteScan::find<'"', '\\', '\0'>(data, start);
+            ret.append(data.substr(start, end - start));
+            currentFile->filePosition = end;
+
             switch (c = readChar())
             {
                 case '"':
@@ -716,7 +913,7 @@ private:
 
     ASASM::Namespace readNamespace()
     {
-        std::string word = readWord();
+        std::string_view word = readWord();
         if (word == "null")
         {
             return {};
@@ -753,7 +950,7 @@ private:
 
     ASASM::Multiname readMultiname()
     {
-        std::string word = readWord();
+        std::string_view word = readWord();
         if (word == "null")
         {
             return {};
@@ -827,8 +1024,9 @@ private:
     ASASM::Trait readTrait()
     {
         ASASM::Trait ret;
-        std::string kind = readWord();
-        auto foundKind   = TraitKindMap.Find(kind.c_str());
+        // Kept for error messages, as the word itself is only valid until the next read
+        const std::string kind(readWord());
+        auto foundKind = TraitKindMap.Find(kind);
         if (!foundKind)
         {
             backpedal(kind.size());
@@ -843,7 +1041,7 @@ private:
                 ret.vSlot({});
                 while (true)
                 {
-                    std::string word = readWord();
+                    std::string_view word = readWord();
                     if (word == "flag")
                     {
                         ret.attributes |= readFlag(TraitAttributeMap);
@@ -872,7 +1070,8 @@ private:
                     else
                     {
                         backpedal(word.size());
-                        throw StringException("Unknown " + kind + " trait field " + word);
+                        throw StringException(
+                            "Unknown " + kind + " trait field " + std::string(word));
                     }
                 }
                 break;
@@ -880,7 +1079,7 @@ private:
                 ret.vClass({});
                 while (true)
                 {
-                    std::string word = readWord();
+                    std::string_view word = readWord();
                     if (word == "flag")
                     {
                         ret.attributes |= readFlag(TraitAttributeMap);
@@ -905,7 +1104,8 @@ private:
                     else
                     {
                         backpedal(word.size());
-                        throw StringException("Unknown " + kind + " trait field " + word);
+                        throw StringException(
+                            "Unknown " + kind + " trait field " + std::string(word));
                     }
                 }
                 break;
@@ -913,7 +1113,7 @@ private:
                 ret.vFunction({});
                 while (true)
                 {
-                    std::string word = readWord();
+                    std::string_view word = readWord();
                     if (word == "flag")
                     {
                         ret.attributes |= readFlag(TraitAttributeMap);
@@ -938,7 +1138,8 @@ private:
                     else
                     {
                         backpedal(word.size());
-                        throw StringException("Unknown " + kind + " trait field " + word);
+                        throw StringException(
+                            "Unknown " + kind + " trait field " + std::string(word));
                     }
                 }
                 break;
@@ -948,7 +1149,7 @@ private:
                 ret.vMethod({});
                 while (true)
                 {
-                    std::string word = readWord();
+                    std::string_view word = readWord();
                     if (word == "flag")
                     {
                         ret.attributes |= readFlag(TraitAttributeMap);
@@ -973,7 +1174,8 @@ private:
                     else
                     {
                         backpedal(word.size());
-                        throw StringException("Unknown " + kind + " trait field " + word);
+                        throw StringException(
+                            "Unknown " + kind + " trait field " + std::string(word));
                     }
                 }
                 break;
@@ -989,7 +1191,7 @@ private:
         std::vector<std::optional<std::string>> items;
         while (true)
         {
-            std::string word = readWord();
+            std::string_view word = readWord();
             if (word == "item")
             {
                 items.emplace_back(readString());
@@ -1027,7 +1229,7 @@ private:
 
         while (true)
         {
-            std::string word = readWord();
+            std::string_view word = readWord();
             if (word == "name")
             {
                 mustBeNull(ret->name);
@@ -1069,7 +1271,7 @@ private:
             }
             else
             {
-                throw StringException("Unknown method field " + word);
+                throw StringException("Unknown method field " + std::string(word));
             }
         }
     }
@@ -1080,7 +1282,7 @@ private:
         ret.name = readMultiname();
         while (true)
         {
-            std::string word = readWord();
+            std::string_view word = readWord();
             if (word == "extends")
             {
                 mustBeNull(ret.superName);
@@ -1115,7 +1317,7 @@ private:
             }
             else
             {
-                throw StringException("Unknown instance field " + word);
+                throw StringException("Unknown instance field " + std::string(word));
             }
         }
     }
@@ -1125,7 +1327,7 @@ private:
         auto ret = std::make_shared<ASASM::Class>();
         while (true)
         {
-            std::string word = readWord();
+            std::string_view word = readWord();
             if (word == "refid")
             {
                 addUnique<addUniqueClass>(classesByID, readRealString(), ret);
@@ -1152,7 +1354,7 @@ private:
             }
             else
             {
-                throw StringException("Unknown class field " + word);
+                throw StringException("Unknown class field " + std::string(word));
             }
         }
     }
@@ -1162,7 +1364,7 @@ private:
         std::shared_ptr<ASASM::Script> ret(new ASASM::Script);
         while (true)
         {
-            std::string word = readWord();
+            std::string_view word = readWord();
             if (word == "sinit")
             {
                 mustBeNull(ret->sinit);
@@ -1181,7 +1383,7 @@ private:
             else
             {
                 backpedal(word.size());
-                throw StringException("Unknown script field " + word);
+                throw StringException("Unknown script field " + std::string(word));
             }
         }
     }
@@ -1192,7 +1394,7 @@ private:
         ASASM::MethodBody ret;
         while (true)
         {
-            std::string word = readWord();
+            std::string_view word = readWord();
             if (word == "maxstack")
             {
                 ret.maxStack = std::max<uint32_t>(ret.maxStack, (uint32_t)readUInt());
@@ -1228,22 +1430,22 @@ private:
             else
             {
                 backpedal(word.size());
-                throw StringException("Unknown method field " + word);
+                throw StringException("Unknown method field " + std::string(word));
             }
         }
     }
 
     SWFABC::Label parseLabel(
-        const std::string& label, const std::unordered_map<std::string, uint32_t>& labels)
+        std::string_view label, const std::unordered_map<std::string, uint32_t>& labels)
     {
-        std::string name = label;
-        int offset       = 0;
+        std::string_view name = label;
+        int offset            = 0;
         for (size_t i = 0; i < label.size(); i++)
         {
             if (label[i] == '-' || label[i] == '+')
             {
-                name   = label.substr(0, i);
-                offset = atoi(label.c_str() + i + 1);
+                name = label.substr(0, i);
+                std::from_chars(label.data() + i + 1, label.data() + label.size(), offset);
                 if (label[i] == '-')
                 {
                     offset = -offset;
@@ -1252,13 +1454,14 @@ private:
             }
         }
 
-        if (!labels.contains(name))
+        const auto found = labels.find(std::string(name));
+        if (found == labels.end())
         {
             backpedal(label.size());
-            throw StringException("Unknown label " + name);
+            throw StringException("Unknown label " + std::string(name));
         }
 
-        return SWFABC::Label{labels.at(name), offset, 0};
+        return SWFABC::Label{found->second, offset, 0};
     }
 
     std::vector<ASASM::Instruction> readInstructions(
@@ -1279,23 +1482,23 @@ private:
 
         while (true)
         {
-            std::string word = readWord();
+            std::string_view word = readWord();
             if (word == "end")
             {
                 break;
             }
             if (peekChar() == ':')
             {
-                addUnique<addUniqueLabel>(labels, word, uint32_t(ret.size()));
+                addUnique<addUniqueLabel>(labels, std::string(word), uint32_t(ret.size()));
                 skipChar();
                 continue;
             }
 
-            auto opcode = OPCodeMap.Find(word.c_str());
+            auto opcode = OPCodeMap.Find(word);
             if (!opcode)
             {
                 backpedal(word.size());
-                throw StringException("Unknown OPCode " + word);
+                throw StringException("Unknown OPCode " + std::string(word));
             }
 
             ASASM::Instruction instruction;
@@ -1363,13 +1566,13 @@ private:
                     case OPCodeArgumentType::SwitchDefaultTarget:
                         instruction.arguments[i].jumpTarget({});
                         jumpFixups.emplace_back(
-                            currentFile->position(), ret.size(), i, readWord(), 0);
+                            currentFile->position(), ret.size(), i, std::string(readWord()), 0);
                         break;
 
                     case OPCodeArgumentType::SwitchTargets:
                     {
                         std::vector<std::string> switchTargetLabels =
-                            readList<'[', ']', false>([this] { return readWord(); });
+                            readList<'[', ']', false>([this] { return std::string(readWord()); });
                         instruction.arguments[i].switchTargets(
                             std::vector<SWFABC::Label>(switchTargetLabels.size()));
                         for (size_t li = 0; li < switchTargetLabels.size(); li++)
@@ -1431,6 +1634,17 @@ private:
             }
         }
 
+        // Class and method fixups keep their positions until the end of the assembly
+        for (const auto& f : jumpFixups)
+        {
+            unpin(f.where);
+        }
+        for (const auto& f : switchFixups)
+        {
+            unpin(f.where);
+        }
+        releaseFiles();
+
         for (const auto& f : localClassFixups)
         {
             classFixups.emplace_back(f.where, ret[f.ii].arguments[f.ai].classv(), f.name);
@@ -1448,7 +1662,7 @@ private:
     {
         auto readLabel = [this, &labels]
         {
-            std::string word = readWord();
+            std::string_view word = readWord();
             try
             {
                 return parseLabel(word, labels);
@@ -1463,7 +1677,7 @@ private:
         ASASM::Exception ret;
         while (true)
         {
-            std::string word = readWord();
+            std::string_view word = readWord();
             if (word == "from")
             {
                 ret.from = readLabel();
@@ -1490,24 +1704,48 @@ private:
             }
             else
             {
-                throw StringException("Unknown exception field " + word);
+                throw StringException("Unknown exception field " + std::string(word));
             }
         }
     }
 
-    Assembler(
-        const std::unordered_map<std::string, std::string>& strings, bool includeDebugInstructions)
-        : strings(strings), includeDebugInstructions(includeDebugInstructions)
+    Assembler(const SourceLookup& sources, bool includeDebugInstructions)
+        : sources(sources), includeDebugInstructions(includeDebugInstructions)
     {
     }
 
+    // When set, every file read is recorded here along with a hash of its contents
+    std::vector<std::pair<std::string, MethodBodyCache::Key>>* reads = nullptr;
+
+    std::string_view source(const std::string& name)
+    {
+        const std::optional<std::string_view> found = sources(name);
+        if (!found)
+        {
+            throw StringException("File not found: " + name);
+        }
+        if (reads)
+        {
+            reads->emplace_back(name, MethodBodyCache::hash(*found));
+        }
+        return *found;
+    }
+
     ASASM::ASProgram readProgram()
     {
         ASASM::ASProgram ret;
         expectWord("program");
         while (true)
         {
-            std::string word = readWord();
+            deferringInto         = part == Part::Main ? &ret : nullptr;
+            atProgramField        = true;
+            std::string_view word = readWord();
+            deferringInto         = nullptr;
+            atProgramField        = false;
+            if ((word == "minorversion" || word == "majorversion") && part == Part::Include)
+            {
+                throw NeedsSerialAssembly{}; // The version applies to the whole program
+            }
             if (word == "minorversion")
             {
                 ret.minorVersion = (uint16_t)readUInt();
@@ -1535,15 +1773,31 @@ private:
             else
             {
                 backpedal(word.size());
-                throw StringException("Unknown program field " + word);
+                throw StringException("Unknown program field " + std::string(word));
             }
         }
     }
 
+    // Where an include's assembler in a parallel assembly is, given the position of the
+    // #include in main.asasm, as a serial assembly would have put it
+    std::string includeContext(const std::string& includedFrom)
+    {
+        if (currentFile->parent == nullptr)
+        {
+            return includedFrom + ": ";
+        }
+        std::string ret = currentFile->positionStr() + ": ";
+        for (SourceFile* f = currentFile->parent; f->parent != nullptr; f = f->parent)
+        {
+            ret += "\n\t(included from " + f->positionStr() + ")";
+        }
+        return ret + "\n\t(included from " + includedFrom + ")";
+    }
+
     std::string context()
     {
         std::string ret = currentFile->positionStr() + ": ";
-        for (std::shared_ptr<SourceFile> f = currentFile->parent; f != nullptr; f = f->parent)
+        for (SourceFile* f = currentFile->parent; f != nullptr; f = f->parent)
         {
             ret += "\n\t(included from " + f->positionStr() + ")";
         }
@@ -1592,20 +1846,723 @@ private:
         methodsByID.clear();
     }
 
+    // Renumbers labelled namespaces, whose ids are the 1-based positions of their labels in the
+    // namespaceLabels of the assembler that read them, to positions in another list of labels
+    class NamespaceRelabeler
+    {
+    private:
+        const std::vector<int>& ids;
+
+    public:
+        explicit NamespaceRelabeler(const std::vector<int>& ids) : ids(ids) {}
+
+        void relabel(ASASM::Namespace& ns)
+        {
+            if (ns.id != 0)
+            {
+                ns.id = ids[ns.id - 1];
+            }
+        }
+
+        void relabel(ASASM::Multiname& multiname)
+        {
+            switch (multiname.kind)
+            {
+                case ABCType::QName:
+                case ABCType::QNameA:
+                    relabel(multiname.qname().ns);
+                    break;
+                case ABCType::Multiname:
+                case ABCType::MultinameA:
+                    for (auto& ns : multiname.multiname().nsSet)
+                    {
+                        relabel(ns);
+                    }
+                    break;
+                case ABCType::MultinameL:
+                case ABCType::MultinameLA:
+                    for (auto& ns : multiname.multinamel().nsSet)
+                    {
+                        relabel(ns);
+                    }
+                    break;
+                case ABCType::TypeName:
+                    relabel(multiname.Typename().name());
+                    for (auto& param : multiname.Typename().params())
+                    {
+                        relabel(param);
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        void relabel(ASASM::Value& value)
+        {
+            switch (value.vkind)
+            {
+                case ABCType::Namespace:
+                case ABCType::PackageNamespace:
+                case ABCType::PackageInternalNs:
+                case ABCType::ProtectedNamespace:
+                case ABCType::ExplicitNamespace:
+                case ABCType::StaticProtectedNs:
+                case ABCType::PrivateNamespace:
+                    relabel(value.vnamespace());
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        void relabel(ASASM::Trait& trait)
+        {
+            relabel(trait.name);
+            switch (trait.kind)
+            {
+                case TraitKind::Slot:
+                case TraitKind::Const:
+                    relabel(trait.vSlot().typeName);
+                    relabel(trait.vSlot().value);
+                    break;
+                case TraitKind::Class:
+                    relabel(trait.vClass().vclass);
+                    break;
+                case TraitKind::Function:
+                    relabel(trait.vFunction().vfunction);
+                    break;
+                case TraitKind::Method:
+                case TraitKind::Getter:
+                case TraitKind::Setter:
+                    relabel(trait.vMethod().vmethod);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        // Changing a trait's name has to go through the list, which may be indexing it
+        void relabel(ASASM::TraitList& traits)
+        {
+            for (size_t i = 0; i < traits.size(); i++)
+            {
+                ASASM::Trait trait = traits[i];
+                relabel(trait);
+                traits.replace(i, std::move(trait));
+            }
+        }
+
+        template <typename T>
+        void relabel(const std::shared_ptr<T>& object)
+        {
+            if (object)
+            {
+                relabel(*object);
+            }
+        }
+
+        void relabel(ASASM::Method& method)
+        {
+            for (auto& type : method.paramTypes)
+            {
+                relabel(type);
+            }
+            relabel(method.returnType);
+            for (auto& option : method.options)
+            {
+                relabel(option);
+            }
+            if (!method.vbody)
+            {
+                return;
+            }
+
+            for (auto& instruction : method.vbody->instructions)
+            {
+                const auto& argumentTypes = OPCode_Info[(uint8_t)instruction.opcode].second;
+                for (size_t i = 0; i < argumentTypes.size(); i++)
+                {
+                    if (argumentTypes[i] == OPCodeArgumentType::Namespace)
+                    {
+                        relabel(instruction.arguments[i].namespacev());
+                    }
+                    else if (argumentTypes[i] == OPCodeArgumentType::Multiname)
+                    {
+                        relabel(instruction.arguments[i].multinamev());
+                    }
+                }
+            }
+            for (auto& exception : method.vbody->exceptions)
+            {
+                relabel(exception.excType);
+                relabel(exception.varName);
+            }
+            for (auto& trait : method.vbody->traits)
+            {
+                relabel(trait);
+            }
+        }
+
+        void relabel(ASASM::Class& vclass)
+        {
+            relabel(vclass.cinit);
+            relabel(vclass.traits);
+            relabel(vclass.instance.name);
+            relabel(vclass.instance.superName);
+            relabel(vclass.instance.protectedNs);
+            for (auto& implemented : vclass.instance.interfaces)
+            {
+                relabel(implemented);
+            }
+            relabel(vclass.instance.iinit);
+            relabel(vclass.instance.traits);
+        }
+
+        // Classes and methods are only reached through what defines them, so each is visited
+        // once, and none are reached through instructions referring to them
+        void relabel(ASASM::ASProgram& program)
+        {
+            for (auto& script : program.scripts)
+            {
+                relabel(script->sinit);
+                relabel(script->traits);
+            }
+            for (auto& vclass : program.orphanClasses)
+            {
+                relabel(*vclass);
+            }
+            for (auto& method : program.orphanMethods)
+            {
+                relabel(*method);
+            }
+        }
+    };
+
+    // What parsing an include on its own gives: its part of the program, with namespace ids
+    // relative to its own labels, and the references it leaves to be resolved once it's linked
+    struct Fragment
+    {
+        ASASM::ASProgram program;
+        std::vector<std::string> namespaceLabels;
+        std::unordered_map<std::string, std::shared_ptr<ASASM::Class>> classesByID;
+        std::unordered_map<std::string, std::shared_ptr<ASASM::Method>> methodsByID;
+        std::vector<Fixup<ASASM::Class>> classFixups;
+        std::vector<Fixup<ASASM::Method>> methodFixups;
+    };
+
+    // Moves everything an include's parse left behind into a fragment. Its fixups are reported at
+    // where, as the files they came from go away with this assembler.
+    Fragment takeFragment(ASASM::ASProgram&& program, Position where)
+    {
+        Fragment ret;
+        ret.program         = std::move(program);
+        ret.namespaceLabels = std::move(namespaceLabels);
+        ret.classesByID     = std::move(classesByID);
+        ret.methodsByID     = std::move(methodsByID);
+        for (const auto& fixup : classFixups)
+        {
+            ret.classFixups.emplace_back(where, fixup.ptr, fixup.name);
+        }
+        for (const auto& fixup : methodFixups)
+        {
+            ret.methodFixups.emplace_back(where, fixup.ptr, fixup.name);
+        }
+        classFixups.clear();
+        methodFixups.clear();
+        return ret;
+    }
+
+    // Deep-copies an unlinked fragment, so that a cached one can be linked into any number of
+    // programs. Until it's linked a fragment is a tree, apart from its refid maps and fixups,
+    // which are pointed at the copies of what they referred to.
+    class FragmentCloner
+    {
+    private:
+        std::unordered_map<const ASASM::Class*, std::shared_ptr<ASASM::Class>> classes;
+        std::unordered_map<const ASASM::Method*, std::shared_ptr<ASASM::Method>> methods;
+        // Class and method instruction arguments, which are what fixups refer to
+        std::unordered_map<const void*, void*> arguments;
+
+        ASASM::Trait clone(const ASASM::Trait& trait)
+        {
+            ASASM::Trait ret = trait;
+            switch (trait.kind)
+            {
+                case TraitKind::Class:
+                    ret.vClass().vclass = clone(trait.vClass().vclass);
+                    break;
+                case TraitKind::Function:
+                    ret.vFunction().vfunction = clone(trait.vFunction().vfunction);
+                    break;
+                case TraitKind::Method:
+                case TraitKind::Getter:
+                case TraitKind::Setter:
+                    ret.vMethod().vmethod = clone(trait.vMethod().vmethod);
+                    break;
+                default:
+                    break;
+            }
+            return ret;
+        }
+
+        std::vector<ASASM::Trait> clone(const std::vector<ASASM::Trait>& traits)
+        {
+            std::vector<ASASM::Trait> ret;
+            ret.reserve(traits.size());
+            for (const auto& trait : traits)
+            {
+                ret.emplace_back(clone(trait));
+            }
+            return ret;
+        }
+
+        ASASM::TraitList clone(const ASASM::TraitList& traits)
+        {
+            return clone((const std::vector<ASASM::Trait>&)traits);
+        }
+
+        std::shared_ptr<ASASM::Method> clone(const std::shared_ptr<ASASM::Method>& method)
+        {
+            if (!method)
+            {
+                return nullptr;
+            }
+            if (auto found = methods.find(method.get()); found != methods.end())
+            {
+                return found->second;
+            }
+
+            auto ret = std::make_shared<ASASM::Method>(*method);
+            methods.emplace(method.get(), ret);
+            if (!ret->vbody)
+            {
+                return ret;
+            }
+
+            ret->vbody->method = ret;
+            for (size_t i = 0; i < ret->vbody->instructions.size(); i++)
+            {
+                const auto& from          = method->vbody->instructions[i];
+                auto& to                  = ret->vbody->instructions[i];
+                const auto& argumentTypes = OPCode_Info[(uint8_t)to.opcode].second;
+                for (size_t j = 0; j < argumentTypes.size(); j++)
+                {
+                    if (argumentTypes[j] == OPCodeArgumentType::Class)
+                    {
+                        arguments.emplace(&from.arguments[j].classv(), &to.arguments[j].classv());
+                    }
+                    else if (argumentTypes[j] == OPCodeArgumentType::Method)
+                    {
+                        arguments.emplace(
+                            &from.arguments[j].methodv(), &to.arguments[j].methodv());
+                    }
+                }
+            }
+            ret->vbody->traits = clone(method->vbody->traits);
+            return ret;
+        }
+
+        std::shared_ptr<ASASM::Class> clone(const std::shared_ptr<ASASM::Class>& vclass)
+        {
+            if (!vclass)
+            {
+                return nullptr;
+            }
+            if (auto found = classes.find(vclass.get()); found != classes.end())
+            {
+                return found->second;
+            }
+
+            auto ret = std::make_shared<ASASM::Class>(*vclass);
+            classes.emplace(vclass.get(), ret);
+            ret->cinit           = clone(vclass->cinit);
+            ret->traits          = clone(vclass->traits);
+            ret->instance.iinit  = clone(vclass->instance.iinit);
+            ret->instance.traits = clone(vclass->instance.traits);
+            return ret;
+        }
+
+        template <typename T>
+        std::shared_ptr<T>& argument(const std::shared_ptr<T>& from)
+        {
+            return *(std::shared_ptr<T>*)arguments.at(&from);
+        }
+
+    public:
+        // The copy's fixups are reported at where
+        Fragment clone(const Fragment& fragment, Position where)
+        {
+            ASASM::ASProgram program;
+            program.minorVersion = fragment.program.minorVersion;
+            program.majorVersion = fragment.program.majorVersion;
+            for (const auto& script : fragment.program.scripts)
+            {
+                program.scripts.emplace_back(std::make_shared<ASASM::Script>(
+                    ASASM::Script{clone(script->sinit), clone(script->traits)}));
+            }
+            for (const auto& vclass : fragment.program.orphanClasses)
+            {
+                program.orphanClasses.emplace_back(clone(vclass));
+            }
+            for (const auto& method : fragment.program.orphanMethods)
+            {
+                program.orphanMethods.emplace_back(clone(method));
+            }
+
+            Fragment ret;
+            ret.program         = std::move(program);
+            ret.namespaceLabels = fragment.namespaceLabels;
+            for (const auto& [id, vclass] : fragment.classesByID)
+            {
+                ret.classesByID.emplace(id, classes.at(vclass.get()));
+            }
+            for (const auto& [id, method] : fragment.methodsByID)
+            {
+                ret.methodsByID.emplace(id, methods.at(method.get()));
+            }
+            for (const auto& fixup : fragment.classFixups)
+            {
+                ret.classFixups.emplace_back(where, argument(fixup.ptr), fixup.name);
+            }
+            for (const auto& fixup : fragment.methodFixups)
+            {
+                ret.methodFixups.emplace_back(where, argument(fixup.ptr), fixup.name);
+            }
+            return ret;
+        }
+    };
+
+public:
+    // The includes of earlier parallel assemblies, as parsed. An include is parsed again only if
+    // a file it read has changed since, or it would start in a different state; otherwise it's
+    // copied from here. Includes that the last assembly didn't reach are dropped.
+    class ParseCache
+    {
+    private:
+        friend class Assembler;
+
+        struct Entry
+        {
+            bool includeDebugInstructions = false;
+            uint32_t sourceVersion        = 0;
+            std::unordered_map<std::string, std::string> vars;
+            std::vector<std::string> knownLabels;
+            // Every file read, the include itself first, with hashes of their contents
+            std::vector<std::pair<std::string, MethodBodyCache::Key>> reads;
+            // Unlinked, with no positions for its fixups
+            std::optional<Fragment> fragment;
+        };
+
+        std::unordered_map<std::string, Entry> entries;
+
+    public:
+        void clear() { entries.clear(); }
+    };
+
+private:
+    // Assembles main.asasm and its top-level #includes concurrently, then links the pieces into
+    // the program a serial assembly would have given. Throws NeedsSerialAssembly whenever that
+    // can't be vouched for (an include changing #set variables or the #version, or not being a
+    // whole number of program fields). Errors are reported like a serial assembly's; of those in
+    // includes, the first include's is.
+    static ASASM::ASProgram assembleInParallel(const SourceLookup& sources,
+        std::string_view mainSource, bool includeDebugInstructions, ParseCache* cache)
+    {
+        Assembler main(sources, includeDebugInstructions);
+        main.part = Part::Main;
+        main.pushFile("main.asasm", mainSource);
+        ASASM::ASProgram ret;
+        try
+        {
+            ret = main.readProgram();
+        }
+        catch (std::exception& e)
+        {
+            throw StringException("\n" + main.context() + "\n" + e.what());
+        }
+
+        const size_t count = main.deferredIncludes.size();
+
+        // Each file's entry goes to its first include; any later ones aren't cached
+        std::vector<ParseCache::Entry*> entries(count, nullptr);
+        if (cache)
+        {
+            std::unordered_map<std::string, ParseCache::Entry> kept;
+            for (size_t i = 0; i < count; i++)
+            {
+                const std::string& name = main.deferredIncludes[i].name;
+                if (kept.contains(name))
+                {
+                    continue;
+                }
+                auto node = cache->entries.extract(name);
+                entries[i] = node ? &kept.insert(std::move(node)).position->second
+                                  : &kept.try_emplace(name).first->second;
+            }
+            cache->entries = std::move(kept);
+        }
+
+        const auto isCurrent = [&](const ParseCache::Entry& entry, const DeferredInclude& include)
+        {
+            if (!entry.fragment || entry.includeDebugInstructions != includeDebugInstructions ||
+                entry.sourceVersion != include.sourceVersion ||
+                entry.vars.size() != include.vars.size() ||
+                !std::equal(entry.knownLabels.begin(), entry.knownLabels.end(),
+                    main.namespaceLabels.begin(),
+                    main.namespaceLabels.begin() + include.namespaceLabels))
+            {
+                return false;
+            }
+            for (const auto& [name, value] : include.vars)
+            {
+                const auto found = entry.vars.find(name);
+                if (found == entry.vars.end() || found->second != value)
+                {
+                    return false;
+                }
+            }
+            for (const auto& [name, hash] : entry.reads)
+            {
+                const std::optional<std::string_view> found = sources(name);
+                if (!found || MethodBodyCache::hash(*found) != hash)
+                {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        // Positions in main.asasm are worked out by moving through it
+        std::mutex mainPositionMutex;
+
+        std::vector<std::optional<Fragment>> fragments(count);
+        const auto assembleInclude = [&](size_t i)
+        {
+            const DeferredInclude& include = main.deferredIncludes[i];
+            ParseCache::Entry* entry       = entries[i];
+            if (entry && isCurrent(*entry, include))
+            {
+                fragments[i] = FragmentCloner().clone(*entry->fragment, include.where);
+                return;
+            }
+            if (entry)
+            {
+                *entry = {};
+            }
+
+            Assembler assembler(sources, includeDebugInstructions);
+            assembler.part          = Part::Include;
+            assembler.vars          = include.vars;
+            assembler.sourceVersion = include.sourceVersion;
+            assembler.namespaceLabels.assign(main.namespaceLabels.begin(),
+                main.namespaceLabels.begin() + include.namespaceLabels);
+            std::vector<std::pair<std::string, MethodBodyCache::Key>> reads;
+            if (entry)
+            {
+                assembler.reads = &reads;
+            }
+
+            assembler.pushFile("main.asasm",
+                assembler.keep("program #include " + toStringLiteral(include.name) + " end"));
+            ASASM::ASProgram program;
+            try
+            {
+                program = assembler.readProgram();
+            }
+            catch (std::exception& e)
+            {
+                std::lock_guard lock(mainPositionMutex);
+                throw StringException(
+                    "\n" + assembler.includeContext(include.where.load()->positionStr()) +
+                    "\n" + e.what());
+            }
+
+            // Ending the program early, or changing what later includes see, needs them all
+            // read in order
+            if (assembler.currentFile->parent != nullptr ||
+                assembler.vars != include.vars ||
+                assembler.sourceVersion != include.sourceVersion)
+            {
+                throw NeedsSerialAssembly{};
+            }
+
+            if (!entry)
+            {
+                fragments[i] = assembler.takeFragment(std::move(program), include.where);
+                return;
+            }
+            entry->includeDebugInstructions = includeDebugInstructions;
+            entry->sourceVersion            = include.sourceVersion;
+            entry->vars.insert(include.vars.begin(), include.vars.end());
+            entry->knownLabels.assign(main.namespaceLabels.begin(),
+                main.namespaceLabels.begin() + include.namespaceLabels);
+            entry->reads = std::move(reads);
+            entry->fragment.emplace(assembler.takeFragment(std::move(program), {}));
+            fragments[i] = FragmentCloner().clone(*entry->fragment, include.where);
+        };
+
+        // Which include fails first depends on timing, so failures are kept by include. An
+        // include that needs the program assembled serially can be why others failed, and
+        // otherwise the first include's error is the one a serial assembly would have given.
+        std::vector<std::exception_ptr> errors(count);
+        std::atomic<bool> needsSerial = false;
+        Parallel::forEach(count,
+            [&](size_t i)
+            {
+                if (needsSerial)
+                {
+                    return;
+                }
+                try
+                {
+                    assembleInclude(i);
+                }
+                catch (NeedsSerialAssembly&)
+                {
+                    needsSerial = true;
+                }
+                catch (...)
+                {
+                    errors[i] = std::current_exception();
+                }
+            });
+        if (needsSerial)
+        {
+            throw NeedsSerialAssembly{};
+        }
+        for (const auto& error : errors)
+        {
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+
+        // Labels get ids in the order a serial assembly would first have met them
+        std::vector<std::string> labels;
+        std::unordered_map<std::string, int> labelIds;
+        const auto labelId = [&](const std::string& label)
+        {
+            auto [found, added] = labelIds.try_emplace(label, int(labels.size() + 1));
+            if (added)
+            {
+                labels.emplace_back(label);
+            }
+            return found->second;
+        };
+        const auto relabel =
+            [&](const std::vector<std::string>& namespaceLabels, ASASM::ASProgram& program)
+        {
+            std::vector<int> ids;
+            bool changed = false;
+            for (const auto& label : namespaceLabels)
+            {
+                ids.emplace_back(labelId(label));
+                changed |= ids.back() != int(ids.size());
+            }
+            if (changed)
+            {
+                NamespaceRelabeler(ids).relabel(program);
+            }
+        };
+        size_t mainLabels = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            for (; mainLabels < main.deferredIncludes[i].namespaceLabels; mainLabels++)
+            {
+                labelId(main.namespaceLabels[mainLabels]);
+            }
+            relabel(fragments[i]->namespaceLabels, fragments[i]->program);
+        }
+        relabel(main.namespaceLabels, ret);
+        main.namespaceLabels = std::move(labels);
+
+        // Then the includes' results are spliced in where they were included, and their
+        // references resolved along with main.asasm's
+        const auto splice = [&](auto member, auto position)
+        {
+            auto& into = ret.*member;
+            std::remove_reference_t<decltype(into)> spliced;
+            size_t taken = 0;
+            for (size_t i = 0; i < count; i++)
+            {
+                const size_t at = main.deferredIncludes[i].*position;
+                std::move(into.begin() + taken, into.begin() + at, std::back_inserter(spliced));
+                taken = at;
+                auto& from = fragments[i]->program.*member;
+                std::move(from.begin(), from.end(), std::back_inserter(spliced));
+            }
+            std::move(into.begin() + taken, into.end(), std::back_inserter(spliced));
+            into = std::move(spliced);
+        };
+        splice(&ASASM::ASProgram::scripts, &DeferredInclude::scripts);
+        splice(&ASASM::ASProgram::orphanClasses, &DeferredInclude::orphanClasses);
+        splice(&ASASM::ASProgram::orphanMethods, &DeferredInclude::orphanMethods);
+
+        try
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                // Clashing ids are reported at the #include that brought them in
+                main.setFile(main.deferredIncludes[i].where.load());
+                for (const auto& [id, vclass] : fragments[i]->classesByID)
+                {
+                    addUnique<addUniqueClass>(main.classesByID, id, vclass);
+                }
+                for (const auto& [id, method] : fragments[i]->methodsByID)
+                {
+                    addUnique<addUniqueMethod>(main.methodsByID, id, method);
+                }
+                for (const auto& fixup : fragments[i]->classFixups)
+                {
+                    main.classFixups.emplace_back(fixup);
+                }
+                for (const auto& fixup : fragments[i]->methodFixups)
+                {
+                    main.methodFixups.emplace_back(fixup);
+                }
+            }
+            main.applyFixups();
+        }
+        catch (std::exception& e)
+        {
+            throw StringException("\n" + main.context() + "\n" + e.what());
+        }
+
+        return ret;
+    }
+
 public:
-    static ASASM::ASProgram assemble(
-        const std::unordered_map<std::string, std::string>& strings, bool includeDebugInstructions)
+    // With parallel set, the files included at the top level of main.asasm (the scripts of a
+    // disassembly) are assembled concurrently, so sources must be safe to call from several
+    // threads at once. Includes that depend on one another have the program assembled serially
+    // instead; errors are thrown as they are found. A cache, if given, is used and updated by
+    // parallel assemblies; it must not be shared by two assemblies at once.
+    static ASASM::ASProgram assemble(const SourceLookup& sources, bool includeDebugInstructions,
+        bool parallel = true, ParseCache* cache = nullptr)
     {
-        if (!strings.contains("main.asasm"))
+        const std::optional<std::string_view> main = sources("main.asasm");
+        if (!main)
         {
             throw StringException("Assembly start (main.asasm) not found");
         }
 
-        Assembler assembler(strings, includeDebugInstructions);
+        if (parallel)
+        {
+            try
+            {
+                return assembleInParallel(sources, *main, includeDebugInstructions, cache);
+            }
+            catch (NeedsSerialAssembly&)
+            {
+                // Assembled serially below
+            }
+        }
 
-        std::shared_ptr<SourceFile> mainFile =
-            std::make_shared<SourceFile>("main.asasm", strings.at("main.asasm"));
-        assembler.pushFile(mainFile);
+        Assembler assembler(sources, includeDebugInstructions);
+
+        assembler.pushFile("main.asasm", *main);
 
         try
         {
@@ -1618,4 +2575,27 @@ public:
             throw StringException("\n" + assembler.context() + "\n" + e.what());
         }
     }
+    static ASASM::ASProgram assemble(const std::unordered_map<std::string, std::string>& strings,
+        bool includeDebugInstructions, ParseCache* cache = nullptr)
+    {
+        return assemble(
+            [&strings](const std::string& name) -> std::optional<std::string_view>
+            {
+                const auto found = strings.find(name);
+                if (found == strings.end())
+                {
+                    return std::nullopt;
+                }
+                return found->second;
+            },
+            includeDebugInstructions, true, cache);
+    }
+
+    // Includes are looked up in the archive's index as they're reached
+    static ASASM::ASProgram assemble(const ProjectArchive& archive, bool includeDebugInstructions,
+        ParseCache* cache = nullptr)
+    {
+        return assemble([&archive](const std::string& name) { return archive.find(name); },
+            includeDebugInstructions, true, cache);
+    }
 };
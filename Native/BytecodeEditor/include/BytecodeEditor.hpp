@@ -1,9 +1,14 @@
 #pragma once
 
 #include "ASASM/ASProgram.hpp"
+#include "ASASM/AStoABC.hpp"
+#include "Assembler.hpp"
+#include "Disassembler.hpp"
 #include "SWF/SWFFile.hpp"
 #include "utils/ANEUtils.hpp"
+#include "utils/CrossReferences.hpp"
 #include "utils/RefBuilder.hpp"
+#include "utils/SymbolIndex.hpp"
 #include <memory>
 #include <optional>
 #include <string>
@@ -33,10 +38,36 @@ public:
         ASASM::ASProgram program;
         RefBuilder namespaceResolver;
         std::vector<std::string> extraNamespaceData;
+        SymbolIndex symbols;
+        CrossReferences xrefs;
+        // Kept between finishAssemble calls so that reassembling after a few edits only redoes
+        // the work those edits affect
+        ASASM::AStoABC lowering;
+        // Created by the first disassembly of a single class or script, and dropped whenever the
+        // program changes, as any change can rename things
+        std::unique_ptr<Disassembler> disassembler;
+
+        PartialAssembly(ASASM::ASProgram&& program, RefBuilder&& namespaceResolver)
+            : program(std::move(program)),
+              namespaceResolver(std::move(namespaceResolver)),
+              symbols(this->program),
+              xrefs(this->program),
+              lowering(this->program)
+        {
+        }
     };
 
     std::unique_ptr<PartialAssembly> partialAssembly;
 
+    // Whether assembly orders constant pools for the smallest output; see ASProgram::toABC
+    bool minimizePoolSizes = false;
+    // Where full disassemblies cache method bodies' instruction listings, if not empty; see
+    // MethodBodyCache
+    std::string disassemblyCacheDirectory;
+    // Lets assembling a project again only reparse the files that have changed, if set. Tasks
+    // hold on to the cache they started with, so it can be turned off while one is running.
+    std::shared_ptr<Assembler::ParseCache> parseCache;
+
     BytecodeEditor(FREContext ctx) noexcept : ctx(ctx) {}
 
     ~BytecodeEditor() noexcept
@@ -49,16 +80,25 @@ public:
 
     FREObject disassemble(std::span<const uint8_t> swf);
     FREObject disassembleAsync(std::span<const uint8_t> swf);
+    // Writes the files to a directory, or to a tar archive if path ends in .tar or a disassembly
+    // archive if it ends in .basasm, instead of returning them
+    FREObject disassembleToPath(std::span<const uint8_t> swf, std::string&& path);
+    FREObject disassembleToPathAsync(std::span<const uint8_t> swf, std::string&& path);
 
     FREObject assemble(
         std::unordered_map<std::string, std::string>&& data, bool includeDebugInstructions);
     FREObject assembleAsync(
         std::unordered_map<std::string, std::string>&& data, bool includeDebugInstructions);
+    // Assembles a disassembly archive (see ProjectArchive) in place
+    FREObject assembleFromPath(std::string&& path, bool includeDebugInstructions);
+    FREObject assembleFromPathAsync(std::string&& path, bool includeDebugInstructions);
 
     FREObject partialAssemble(
         std::unordered_map<std::string, std::string>&& data, bool includeDebugInstructions);
     FREObject partialAssembleAsync(
         std::unordered_map<std::string, std::string>&& data, bool includeDebugInstructions);
+    // The partial assembly is kept after finishing, until the next partial assembly or cleanup(),
+    // so it can be edited and finished again without redoing the work unaffected by the edits
     FREObject finishAssemble();
     FREObject finishAssembleAsync();
 
@@ -80,6 +120,10 @@ public:
         }
         partialAssembly = nullptr;
         m_taskResult    = std::monostate{};
+        if (parseCache)
+        {
+            parseCache->clear();
+        }
     }
 
     FREObject taskResult();
@@ -108,4 +152,8 @@ public:
     std::pair<FREObject, bool> ConvertInstruction(const ASASM::Instruction& i) const;
     ASASM::Value ConvertValue(FREObject o) const;
     FREObject ConvertValue(const ASASM::Value& v) const;
+    FREObject ConvertUsages(const std::vector<CrossReferences::Usage>& usages) const;
+    FREObject ConvertFiles(const std::unordered_map<std::string, std::string>& files) const;
+    // A ByteArray holding a DoABC tag with the given ABC data
+    FREObject ConvertABCTag(const std::vector<uint8_t>& abc) const;
 };
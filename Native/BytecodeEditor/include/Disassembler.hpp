@@ -16,38 +16,127 @@
 #include "enums/InstanceFlags.hpp"
 #include "enums/MethodFlags.hpp"
 #include "enums/TraitAttribute.hpp"
+#include "utils/ByteScan.hpp"
+#include "utils/DisassemblySink.hpp"
+#include "utils/MethodBodyCache.hpp"
+#include "utils/Parallel.hpp"
 #include "utils/RefBuilder.hpp"
 #include "utils/StringBuilder.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <charconv>
 #include <climits>
 #include <cmath>
 #include <cstring>
-#include <sstream>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <vector>
 
 class Disassembler
 {
 private:
-    std::unordered_map<std::string, std::string> strings;
+    // A file written by disassemble(). Its includes are dumped concurrently, a batch at a time.
+    struct IncludeFile : public StringBuilder
+    {
+        std::string filename;
+        std::function<void(StringBuilder&)> dump;
+
+        // Every file included by this one, in order
+        std::vector<std::unique_ptr<IncludeFile>> includes;
+    };
+
     const ASASM::ASProgram& as;
 
     RefBuilder refs;
-    bool dumpRaw = true;
+    MethodBodyCache* bodyCache;
+    bool dumpRaw  = true;
+    bool prepared = false;
+
+    // The file name of every script, class and method a full dump reaches, keyed by the same
+    // pointers as refs. RefBuilder hands out file names in the order they're asked for, so they
+    // are all given out up front, in the order of a serial dump.
+    std::unordered_map<const void*, std::string> filenames;
+
+    template <typename Names>
+    const std::string& filenameOf(Names& names, const void* obj, std::string_view suffix)
+    {
+        if (auto found = filenames.find(obj); found != filenames.end())
+        {
+            return found->second;
+        }
+        return filenames.emplace(obj, names.getFilename(obj, suffix)).first->second;
+    }
+
+    // Names the files reached through traits the same way the dump functions below do. Methods
+    // and functions outside scripts are dumped inline, but are still named, as naming can change
+    // the names of later ones.
+    void nameIncludes(const std::vector<ASASM::Trait>& traits)
+    {
+        for (const auto& trait : traits)
+        {
+            switch (trait.kind)
+            {
+                case TraitKind::Class:
+                    filenameOf(refs.objects, trait.vClass().vclass.get(), "class");
+                    nameIncludes(*trait.vClass().vclass);
+                    break;
+                case TraitKind::Function:
+                    filenameOf(refs.objects, trait.vFunction().vfunction.get(), "method");
+                    nameIncludes(*trait.vFunction().vfunction);
+                    break;
+                case TraitKind::Method:
+                case TraitKind::Getter:
+                case TraitKind::Setter:
+                    filenameOf(refs.objects, trait.vMethod().vmethod.get(), "method");
+                    nameIncludes(*trait.vMethod().vmethod);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    void nameIncludes(const ASASM::Method& method)
+    {
+        if (method.vbody)
+        {
+            nameIncludes(method.vbody->traits);
+        }
+    }
+
+    void nameIncludes(const ASASM::Class& vclass)
+    {
+        nameIncludes(*vclass.instance.iinit);
+        nameIncludes(vclass.instance.traits);
+        nameIncludes(*vclass.cinit);
+        nameIncludes(vclass.traits);
+    }
+
+    void nameIncludes(const ASASM::Script& script)
+    {
+        nameIncludes(*script.sinit);
+        nameIncludes(script.traits);
+    }
 
     template <typename Callback>
-    void newInclude(
-        StringBuilder& mainsb, std::string_view filename, Callback callback, bool doInline = true)
+    void newInclude(StringBuilder& mainsb, const void* obj, Callback callback, bool doInline = true)
     {
         if (doInline)
         {
-            StringBuilder sb;
-            callback(sb);
-            strings.insert_or_assign(std::string(filename), sb.str());
+            // Everything that can reach here is being dumped into an IncludeFile
+            IncludeFile& file = static_cast<IncludeFile&>(mainsb);
+
+            auto& include     = file.includes.emplace_back(std::make_unique<IncludeFile>());
+            include->filename = filenames.at(obj);
+            include->dump     = std::move(callback);
 
             mainsb << "#include ";
-            dumpString(mainsb, filename);
+            dumpString(mainsb, include->filename);
             mainsb.newLine();
         }
         else
@@ -56,14 +145,94 @@ private:
         }
     }
 
+    // Dumps the includes of a dumped file and writes them to sink, in order. They're dumped a
+    // batch at a time, and freed once written, so only the files between the one disassembly
+    // started from and the one being written are held in memory. Returns the file's text.
+    std::string finishInclude(IncludeFile& file, DisassemblySink& sink)
+    {
+        for (size_t i = 0; i < file.includes.size(); i++)
+        {
+            if (file.includes[i]->dump)
+            {
+                const size_t batchSize = Parallel::workerCount(file.includes.size() - i);
+                Parallel::forEach(batchSize,
+                    [&file, i](size_t j)
+                    {
+                        IncludeFile& include = *file.includes[i + j];
+                        include.dump(include);
+                        include.dump = nullptr;
+                    });
+            }
+
+            auto& include = file.includes[i];
+            sink.write(include->filename, finishInclude(*include, sink));
+            include = nullptr;
+        }
+        return file.release();
+    }
+
+    // Dumps one include into a file of its own and writes it, and the files it includes, to sink
+    template <typename Callback>
+    void disassembleInclude(const void* obj, Callback callback, DisassemblySink& sink)
+    {
+        prepare();
+
+        IncludeFile root;
+        newInclude(root, obj, std::move(callback));
+        (void)finishInclude(root, sink);
+        sink.finish();
+    }
+
 public:
-    Disassembler(const ASASM::ASProgram& as) : as(as), refs(as) {}
+    // Instruction listings are looked up in and added to bodyCache, if given
+    Disassembler(const ASASM::ASProgram& as, MethodBodyCache* bodyCache = nullptr)
+        : as(as), refs(as), bodyCache(bodyCache)
+    {
+    }
 
-    std::unordered_map<std::string, std::string> disassemble()
+    // Runs the reference builder and names every file. Done once; until then, by the first
+    // disassembly.
+    void prepare()
     {
+        if (prepared)
+        {
+            return;
+        }
+
         refs.run();
 
-        StringBuilder sb;
+        for (size_t i = 0; i < as.scripts.size(); i++)
+        {
+            filenameOf(refs.scripts, &as.scripts[i], "script");
+            nameIncludes(*as.scripts[i]);
+        }
+        for (const auto& vclass : as.orphanClasses)
+        {
+            filenameOf(refs.objects, vclass.get(), "class");
+            nameIncludes(*vclass);
+        }
+        for (const auto& method : as.orphanMethods)
+        {
+            filenameOf(refs.objects, method.get(), "method");
+            nameIncludes(*method);
+        }
+
+        prepared = true;
+    }
+
+    std::unordered_map<std::string, std::string> disassemble()
+    {
+        MapSink sink;
+        disassemble(sink);
+        return std::move(sink.files);
+    }
+
+    // Writes each file to sink as soon as it is finished
+    void disassemble(DisassemblySink& sink)
+    {
+        prepare();
+
+        IncludeFile sb;
 
         sb << "#version 4";
         sb.newLine();
@@ -80,7 +249,7 @@ public:
 
         for (size_t i = 0; i < as.scripts.size(); i++)
         {
-            newInclude(sb, refs.scripts.getFilename(&as.scripts[i], "script"),
+            newInclude(sb, &as.scripts[i],
                 [this, i](StringBuilder& sb) { dumpScript(sb, *as.scripts[i], i); });
         }
         sb.newLine();
@@ -93,7 +262,7 @@ public:
 
             for (size_t i = 0; i < as.orphanClasses.size(); i++)
             {
-                newInclude(sb, refs.objects.getFilename(as.orphanClasses[i].get(), "class"),
+                newInclude(sb, as.orphanClasses[i].get(),
                     [this, i](StringBuilder& sb) { dumpClass(sb, *as.orphanClasses[i]); });
             }
             sb.newLine();
@@ -107,7 +276,7 @@ public:
 
             for (size_t i = 0; i < as.orphanMethods.size(); i++)
             {
-                newInclude(sb, refs.objects.getFilename(as.orphanMethods[i].get(), "method"),
+                newInclude(sb, as.orphanMethods[i].get(),
                     [this, i](StringBuilder& sb)
                     { dumpMethod(sb, *as.orphanMethods[i], "method"); });
             }
@@ -118,8 +287,48 @@ public:
         sb << "end ; program";
         sb.newLine();
 
-        strings.insert_or_assign(std::string("main.asasm"), sb.str());
-        return std::move(strings);
+        sink.write("main.asasm", finishInclude(sb, sink));
+        sink.finish();
+    }
+
+    // Writes the file a full disassembly would give the script, and the files it includes, to sink.
+    // Only the first call has to look at the whole program.
+    void disassemble(const ASASM::Script& script, DisassemblySink& sink)
+    {
+        const auto found = std::find_if(as.scripts.begin(), as.scripts.end(),
+            [&script](const auto& s) { return s.get() == &script; });
+        if (found == as.scripts.end())
+        {
+            throw StringException("Script is not part of the program");
+        }
+
+        const uint32_t index = uint32_t(found - as.scripts.begin());
+        disassembleInclude(&*found,
+            [this, &script, index](StringBuilder& sb) { dumpScript(sb, script, index); }, sink);
+    }
+
+    // Writes the file a full disassembly would give the class, and the files it includes, to sink
+    void disassemble(const ASASM::Class& vclass, DisassemblySink& sink)
+    {
+        prepare();
+        if (!filenames.contains(&vclass))
+        {
+            throw StringException("Class is not part of the program");
+        }
+
+        disassembleInclude(
+            &vclass, [this, &vclass](StringBuilder& sb) { dumpClass(sb, vclass); }, sink);
+    }
+
+    // Writes the method to sink. Methods that a full disassembly dumps inline, such as class
+    // methods, are given the file they would have had if they weren't.
+    void disassemble(const ASASM::Method& method, DisassemblySink& sink)
+    {
+        prepare();
+        filenameOf(refs.objects, &method, "method");
+        disassembleInclude(
+            &method, [this, &method](StringBuilder& sb) { dumpMethod(sb, method, "method"); },
+            sink);
     }
 
     void dumpInt(StringBuilder& sb, int64_t v)
@@ -167,42 +376,81 @@ public:
         }
         else
         {
-            std::array<char, 20> formatStr;
-            std::array<std::array<char, 64>, 19> precisions;
-            std::array<int, 19> lengths;
-
-            // Try all precisions of printing from 0-18
-            for (int i = 0; i <= 18; i++)
+            // Prints the shortest of the %.0g to %.18g forms of v that reads back as v, preferring
+            // the lowest precision on ties. Forms with fewer significant digits than the shortest
+            // round-trip representation never read back, and a lower bound on the length of the
+            // others rules most of them out without formatting them.
+            std::array<char, 32> shortest;
+            char* shortestEnd = std::to_chars(shortest.data(), shortest.data() + shortest.size(), v,
+                std::chars_format::scientific)
+                                    .ptr;
+            char* exponentStart      = std::find(shortest.data(), shortestEnd, 'e') + 1;
+            const int shortestDigits = (int)std::count_if(shortest.data(), exponentStart,
+                [](char c) { return c >= '0' && c <= '9'; });
+            int exponent = 0;
+            std::from_chars(
+                exponentStart + (*exponentStart == '+' ? 1 : 0), shortestEnd, exponent);
+
+            // A %g form has at least as many digits as the shortest representation, give or take
+            // the one that can be traded for a shorter exponent, and its exponent is within one of
+            // the shortest representation's
+            const int minDigits  = std::max(1, shortestDigits - 1);
+            const auto minLength = [&](int precision)
             {
-                sprintf(formatStr.data(), "%%.%ig", i);
-                sprintf(precisions[i].data(), formatStr.data(), v);
-
-                lengths[i] = strlen(precisions[i].data());
-            }
+                int ret = INT_MAX;
+                for (int e = exponent - 1; e <= exponent + 1; e++)
+                {
+                    int length = std::signbit(v) ? 1 : 0;
+                    if (e < -4 || e >= precision)
+                    {
+                        // d[.ddd]e+XX
+                        length += minDigits + (minDigits > 1 ? 1 : 0) + 2 +
+                                  (std::abs(e) >= 100 ? 3 : 2);
+                    }
+                    else if (e >= 0)
+                    {
+                        length += std::max(minDigits, e + 1) + (minDigits > e + 1 ? 1 : 0);
+                    }
+                    else
+                    {
+                        length += 1 - e + minDigits;
+                    }
+                    ret = std::min(ret, length);
+                }
+                return ret;
+            };
 
-            int current      = INT_MAX;
-            int currentIndex = -1;
-            for (int i = 0; i <= 18; i++)
+            std::array<char, 32> best;
+            int bestLength = INT_MAX;
+            for (int precision = minDigits; precision <= 18; precision++)
             {
-                if (current > lengths[i] && std::strtod(precisions[i].data(), nullptr) == v)
+                if (minLength(precision) >= bestLength)
                 {
-                    currentIndex = i;
-                    current      = lengths[i];
+                    // Past the last exponent that could use scientific notation, the bound stops
+                    // changing
+                    if (precision > exponent + 1)
+                    {
+                        break;
+                    }
+                    continue;
                 }
-            }
 
-            if (currentIndex != -1)
-            {
-                sb << precisions[currentIndex].data();
-                return;
+                std::array<char, 32> formatted;
+                const char* formattedEnd = std::to_chars(formatted.data(),
+                    formatted.data() + formatted.size(), v, std::chars_format::general, precision)
+                                               .ptr;
+                double parsed = 0;
+                std::from_chars(formatted.data(), formattedEnd, parsed);
+                if (parsed == v && formattedEnd - formatted.data() < bestLength)
+                {
+                    best       = formatted;
+                    bestLength = int(formattedEnd - formatted.data());
+                }
             }
 
-            // Otherwise we try hex notation
-
-            sprintf(precisions[0].data(), "%.13a", v);
-            assert(std::strtod(precisions[0].data(), nullptr) == v);
-
-            sb << precisions[0].data();
+            // %.17g always reads back, and is only skipped once something shorter has
+            assert(bestLength != INT_MAX);
+            sb << std::string_view(best.data(), bestLength);
         }
     }
 
@@ -229,8 +477,19 @@ public:
             '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
 
         sb << '"';
-        for (unsigned char c : str)
+        size_t i = 0;
+        while (true)
         {
+            // Runs of characters that need no escaping are copied in one go
+            const size_t end = ByteScan::findControlOr<'\\', '"'>(str, i);
+            sb << str.substr(i, end - i);
+            if (end == str.size())
+            {
+                break;
+            }
+            i = end + 1;
+
+            const unsigned char c = str[end];
             if (c == '\n')
             {
                 sb << "\\n";
@@ -247,13 +506,9 @@ public:
             {
                 sb << "\\\"";
             }
-            else if (c < 0x20)
-            {
-                sb << "\\x" << hexDigits[c / 0x10] << hexDigits[c % 0x10];
-            }
             else
             {
-                sb << c;
+                sb << "\\x" << hexDigits[c / 0x10] << hexDigits[c % 0x10];
             }
         }
         sb << '"';
@@ -402,7 +657,7 @@ public:
                     sb.indent++;
                     sb.newLine();
 
-                    newInclude(sb, refs.objects.getFilename(trait.vClass().vclass.get(), "class"),
+                    newInclude(sb, trait.vClass().vclass.get(),
                         [this, &trait](StringBuilder& sb)
                         { dumpClass(sb, *trait.vClass().vclass); });
                     break;
@@ -414,8 +669,7 @@ public:
                     }
                     sb.indent++;
                     sb.newLine();
-                    newInclude(
-                        sb, refs.objects.getFilename(trait.vFunction().vfunction.get(), "method"),
+                    newInclude(sb, trait.vFunction().vfunction.get(),
                         [this, &trait](StringBuilder& sb)
                         { dumpMethod(sb, *trait.vFunction().vfunction, "method"); },
                         inScript);
@@ -430,8 +684,7 @@ public:
                     }
                     sb.indent++;
                     sb.newLine();
-                    newInclude(
-                        sb, refs.objects.getFilename(trait.vMethod().vmethod.get(), "method"),
+                    newInclude(sb, trait.vMethod().vmethod.get(),
                         [this, &trait](StringBuilder& sb)
                         { dumpMethod(sb, *trait.vMethod().vmethod, "method"); },
                         inScript);
@@ -466,7 +719,7 @@ public:
     }
 
     void dumpTraits(
-        StringBuilder& sb, const std::vector<ASASM::Trait> traits, bool inScript = false)
+        StringBuilder& sb, const std::vector<ASASM::Trait>& traits, bool inScript = false)
     {
         dumpTraits(sb, traits.data(), traits.size(), inScript);
     }
@@ -718,7 +971,26 @@ public:
         }
 
         sb.indent++;
-        dumpInstructions(sb, body.instructions, labels, body.errors);
+        if (bodyCache)
+        {
+            const auto key = MethodBodyCache::hash(instructionsKey(body));
+            if (auto cached = bodyCache->find(key))
+            {
+                sb << *cached;
+            }
+            else
+            {
+                StringBuilder code;
+                code.indent = sb.indent;
+                dumpInstructions(code, body.instructions, labels, body.errors);
+                bodyCache->store(key, code.str());
+                sb << code.str();
+            }
+        }
+        else
+        {
+            dumpInstructions(sb, body.instructions, labels, body.errors);
+        }
         sb.indent--;
 
         sb << "end ; code";
@@ -748,6 +1020,160 @@ public:
         sb.linePrefix = "";
     }
 
+    // Everything the instruction listing of a body depends on, including the names it resolves
+    // through refs, in a form that can't be ambiguous
+    std::string instructionsKey(const ASASM::MethodBody& body)
+    {
+        std::string key;
+        const auto addInt = [&key](uint64_t v) { key.append((const char*)&v, sizeof(v)); };
+
+        const auto addString = [&key, &addInt](const std::optional<std::string>& str)
+        {
+            addInt(str ? str->size() : UINT64_MAX);
+            if (str)
+            {
+                key += *str;
+            }
+        };
+        const auto addNamespace = [this, &addInt, &addString](const ASASM::Namespace& ns)
+        {
+            addInt(uint64_t(ns.kind));
+            if (ns.kind != ABCType::Void)
+            {
+                addString(ns.name);
+                addString(refs.hasHomonyms(ns)
+                              ? std::optional(refs.namespaces[(uint8_t)ns.kind].getName(ns.id))
+                              : std::nullopt);
+            }
+        };
+        const auto addNamespaceSet = [&addInt, &addNamespace](const auto& nsSet)
+        {
+            addInt(nsSet.size());
+            for (const auto& ns : nsSet)
+            {
+                addNamespace(ns);
+            }
+        };
+        const auto addMultiname = [&](const auto& self, const ASASM::Multiname& multiname) -> void
+        {
+            addInt(uint64_t(multiname.kind));
+            switch (multiname.kind)
+            {
+                case ABCType::QName:
+                case ABCType::QNameA:
+                    addNamespace(multiname.qname().ns);
+                    addString(multiname.qname().name);
+                    break;
+                case ABCType::RTQName:
+                case ABCType::RTQNameA:
+                    addString(multiname.rtqname().name);
+                    break;
+                case ABCType::Multiname:
+                case ABCType::MultinameA:
+                    addString(multiname.multiname().name);
+                    addNamespaceSet(multiname.multiname().nsSet);
+                    break;
+                case ABCType::MultinameL:
+                case ABCType::MultinameLA:
+                    addNamespaceSet(multiname.multinamel().nsSet);
+                    break;
+                case ABCType::TypeName:
+                    self(self, multiname.Typename().name());
+                    addInt(multiname.Typename().params().size());
+                    for (const auto& param : multiname.Typename().params())
+                    {
+                        self(self, param);
+                    }
+                    break;
+                default:
+                    break;
+            }
+        };
+        const auto addLabel = [&addInt](const SWFABC::Label& label)
+        {
+            addInt(label.index);
+            addInt(uint64_t(label.offset));
+        };
+
+        // Exception labels are reserved in the listing
+        addInt(body.exceptions.size());
+        for (const auto& e : body.exceptions)
+        {
+            addInt(e.from.index);
+            addInt(e.to.index);
+            addInt(e.target.index);
+        }
+
+        addInt(body.errors.size());
+        for (const auto& error : body.errors)
+        {
+            addInt(error.loc.index);
+            addString(error.message);
+        }
+
+        addInt(body.instructions.size());
+        for (const auto& instruction : body.instructions)
+        {
+            addInt(uint64_t(instruction.opcode));
+
+            const auto& argTypes = OPCode_Info[(uint8_t)instruction.opcode].second;
+            for (size_t i = 0; i < argTypes.size(); i++)
+            {
+                const auto& argument = instruction.arguments[i];
+                switch (argTypes[i])
+                {
+                    case OPCodeArgumentType::ByteLiteral:
+                        addInt(uint64_t(argument.bytev()));
+                        break;
+                    case OPCodeArgumentType::UByteLiteral:
+                        addInt(argument.ubytev());
+                        break;
+                    case OPCodeArgumentType::IntLiteral:
+                    case OPCodeArgumentType::Int:
+                        addInt(uint64_t(argument.intv()));
+                        break;
+                    case OPCodeArgumentType::UIntLiteral:
+                    case OPCodeArgumentType::UInt:
+                        addInt(argument.uintv());
+                        break;
+                    case OPCodeArgumentType::Double:
+                        addInt(std::bit_cast<uint64_t>(argument.doublev()));
+                        break;
+                    case OPCodeArgumentType::String:
+                        addString(argument.stringv());
+                        break;
+                    case OPCodeArgumentType::Namespace:
+                        addNamespace(argument.namespacev());
+                        break;
+                    case OPCodeArgumentType::Multiname:
+                        addMultiname(addMultiname, argument.multinamev());
+                        break;
+                    case OPCodeArgumentType::Class:
+                        addString(refs.objects.getName(argument.classv().get()));
+                        break;
+                    case OPCodeArgumentType::Method:
+                        addString(refs.objects.getName(argument.methodv().get()));
+                        break;
+                    case OPCodeArgumentType::JumpTarget:
+                    case OPCodeArgumentType::SwitchDefaultTarget:
+                        addLabel(argument.jumpTarget());
+                        break;
+                    case OPCodeArgumentType::SwitchTargets:
+                        addInt(argument.switchTargets().size());
+                        for (const auto& label : argument.switchTargets())
+                        {
+                            addLabel(label);
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+
+        return key;
+    }
+
     void dumpInstructions(StringBuilder& sb, const std::vector<ASASM::Instruction>& instructions,
         std::vector<bool>& labels, const std::vector<SWFABC::Error>& errors)
     {
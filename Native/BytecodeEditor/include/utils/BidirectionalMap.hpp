@@ -1,10 +1,13 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <bit>
 #include <functional>
 #include <optional>
 #include <ranges>
 #include <span>
+#include <stdint.h>
 #include <string_view>
 #include <type_traits>
 #include <utility>
@@ -124,6 +127,265 @@ namespace BidirectionalMapInternals
 
     template <std::size_t V1, std::size_t V2>
     concept is_less = (V1 < V2);
+
+    template <typename T>
+    concept StringLike = std::is_same_v<T, const char*> || std::is_same_v<T, char*> ||
+                         std::is_same_v<T, std::string_view>;
+
+    template <typename T>
+    concept IntegerLike = std::is_integral_v<T> || std::is_enum_v<T>;
+
+    template <typename Comparator, typename T>
+    concept ComparesByValue =
+        std::is_same_v<Comparator, std::equal_to<>> || std::is_same_v<Comparator, std::equal_to<T>>;
+
+    enum class IndexKind
+    {
+        Scan,   // searched linearly
+        Direct, // a table with a slot for every possible value
+        Hash,   // a perfect hash table
+    };
+
+    // Lookups are only indexed when the comparator is known to agree with the index: strings
+    // compared by content, and integers and enums compared by value
+    template <typename T, typename Comparator>
+    consteval IndexKind indexKindFor()
+    {
+        if constexpr (StringLike<T> && (std::is_same_v<Comparator, cstringcomp> ||
+                                           (std::is_same_v<T, std::string_view> &&
+                                               ComparesByValue<Comparator, T>)))
+        {
+            return IndexKind::Hash;
+        }
+        else if constexpr (IntegerLike<T> && ComparesByValue<Comparator, T>)
+        {
+            return sizeof(T) == 1 ? IndexKind::Direct : IndexKind::Hash;
+        }
+        else
+        {
+            return IndexKind::Scan;
+        }
+    }
+
+    // Whether a lookup of an S can use the index of a side of type T
+    template <typename T, typename S>
+    concept IndexableAs = (StringLike<T> && std::convertible_to<const S&, std::string_view>) ||
+                          (IntegerLike<T> && std::same_as<S, T>);
+
+    template <typename S>
+    constexpr std::string_view asStringView(const S& str)
+    {
+        // cstringcomp treats null strings as empty ones
+        if constexpr (std::is_pointer_v<S>)
+        {
+            return str == nullptr ? std::string_view() : std::string_view(str);
+        }
+        else
+        {
+            return std::string_view(str);
+        }
+    }
+
+    constexpr uint64_t mix(uint64_t h)
+    {
+        h ^= h >> 30;
+        h *= 0xbf58476d1ce4e5b9ull;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111ebull;
+        h ^= h >> 31;
+        return h;
+    }
+
+    template <typename T, typename S>
+    constexpr uint64_t hashAs(const S& search, uint64_t seed)
+    {
+        if constexpr (StringLike<T>)
+        {
+            // FNV-1a
+            uint64_t h = 0xcbf29ce484222325ull ^ seed;
+            for (char c : asStringView(search))
+            {
+                h ^= uint8_t(c);
+                h *= 0x100000001b3ull;
+            }
+            return mix(h);
+        }
+        else
+        {
+            return mix(uint64_t(search) ^ seed);
+        }
+    }
+
+    // Finds the entry with a given key (or value) in constant time, built when the map is. Hashed
+    // sides use hash-and-displace: a key's hash picks a bucket and the bucket's displacement
+    // then picks the key's slot, with displacements chosen at compile time so that no two keys
+    // share a slot. Tables are kept half empty, which keeps that search short.
+    template <typename T, typename Comparator, std::size_t Size>
+    class LookupIndex
+    {
+    private:
+        static constexpr IndexKind kind = indexKindFor<T, Comparator>();
+
+        static constexpr std::size_t slotCount =
+            kind == IndexKind::Direct ? 256
+            : kind == IndexKind::Hash ? std::bit_ceil(std::max<std::size_t>(2 * Size, 4))
+                                      : 0;
+        static constexpr std::size_t bucketCount = kind == IndexKind::Hash ? slotCount / 4 : 0;
+
+        static_assert(kind != IndexKind::Hash || Size < 0x8000, "Too many entries to hash");
+
+        // Entry index plus one, or 0 for a slot without an entry
+        std::array<uint16_t, slotCount> slots{};
+        std::array<uint16_t, bucketCount> displacements{};
+        uint64_t seed = 0;
+
+        static constexpr std::size_t bucketOf(uint64_t hash)
+        {
+            return std::size_t(hash >> 32) & (bucketCount - 1);
+        }
+
+        static constexpr std::size_t slotOf(uint64_t hash, std::size_t displacement)
+        {
+            return (std::size_t(uint32_t(hash)) ^ displacement) & (slotCount - 1);
+        }
+
+        consteval bool tryBuild(std::size_t count, const auto& at, const auto& equal)
+        {
+            slots         = {};
+            displacements = {};
+
+            // Entries sorted by bucket, keeping their order within each
+            std::array<uint64_t, Size> hashes{};
+            std::array<uint16_t, Size> members{};
+            std::array<std::size_t, bucketCount + 1> starts{};
+            for (std::size_t i = 0; i < count; i++)
+            {
+                hashes[i] = hashAs<T>(at(i), seed);
+                starts[bucketOf(hashes[i]) + 1]++;
+            }
+            std::size_t largest = 0;
+            for (std::size_t b = 0; b < bucketCount; b++)
+            {
+                largest        = std::max(largest, starts[b + 1]);
+                starts[b + 1] += starts[b];
+            }
+            std::array<std::size_t, bucketCount + 1> next = starts;
+            for (std::size_t i = 0; i < count; i++)
+            {
+                members[next[bucketOf(hashes[i])]++] = uint16_t(i);
+            }
+
+            // Bigger buckets are placed first, while there's the most room
+            std::array<uint16_t, Size> keys{};
+            for (std::size_t size = largest; size > 0; size--)
+            {
+                for (std::size_t b = 0; b < bucketCount; b++)
+                {
+                    if (starts[b + 1] - starts[b] != size)
+                    {
+                        continue;
+                    }
+
+                    // Repeated keys are left out, so lookups find the first as a scan would
+                    std::size_t keyCount = 0;
+                    for (std::size_t m = starts[b]; m < starts[b + 1]; m++)
+                    {
+                        bool repeated = false;
+                        for (std::size_t k = 0; k < keyCount; k++)
+                        {
+                            if (equal(keys[k], members[m]))
+                            {
+                                repeated = true;
+                            }
+                            // Displacing both by the same amount can't separate these
+                            else if (slotOf(hashes[keys[k]], 0) == slotOf(hashes[members[m]], 0))
+                            {
+                                return false;
+                            }
+                        }
+                        if (!repeated)
+                        {
+                            keys[keyCount++] = members[m];
+                        }
+                    }
+
+                    std::size_t displacement = 0;
+                    for (; displacement < slotCount; displacement++)
+                    {
+                        bool fits = true;
+                        for (std::size_t k = 0; k < keyCount && fits; k++)
+                        {
+                            fits = slots[slotOf(hashes[keys[k]], displacement)] == 0;
+                        }
+                        if (fits)
+                        {
+                            break;
+                        }
+                    }
+                    if (displacement == slotCount)
+                    {
+                        return false;
+                    }
+
+                    displacements[b] = uint16_t(displacement);
+                    for (std::size_t k = 0; k < keyCount; k++)
+                    {
+                        slots[slotOf(hashes[keys[k]], displacement)] = uint16_t(keys[k] + 1);
+                    }
+                }
+            }
+            return true;
+        }
+
+    public:
+        static constexpr std::size_t npos = std::size_t(-1);
+
+        template <typename S>
+        static constexpr bool indexes =
+            kind != IndexKind::Scan && IndexableAs<T, std::remove_cvref_t<S>>;
+
+        // at(i) gives the i-th entry's side, and equal(i, j) compares two entries' sides
+        consteval void build(std::size_t count, const auto& at, const auto& equal)
+        {
+            if constexpr (kind == IndexKind::Direct)
+            {
+                for (std::size_t i = 0; i < count; i++)
+                {
+                    uint16_t& slot = slots[uint8_t(at(i))];
+                    if (slot == 0)
+                    {
+                        slot = uint16_t(i + 1);
+                    }
+                }
+            }
+            else if constexpr (kind == IndexKind::Hash)
+            {
+                for (seed = 0; !tryBuild(count, at, equal); seed++)
+                {
+                    if (seed == 1000)
+                    {
+                        throw "No perfect hash found for this map";
+                    }
+                }
+            }
+        }
+
+        // The only entry that can match search, or npos. The caller still has to compare them.
+        template <typename S>
+            requires indexes<S>
+        constexpr std::size_t find(const S& search) const
+        {
+            if constexpr (kind == IndexKind::Direct)
+            {
+                return std::size_t(slots[uint8_t(search)]) - 1;
+            }
+            else
+            {
+                const uint64_t hash = hashAs<T>(search, seed);
+                return std::size_t(slots[slotOf(hash, displacements[bucketOf(hash)])]) - 1;
+            }
+        }
+    };
 } // namespace BidirectionalMapInternals
 
 template <std::movable Key, std::movable Value, std::size_t Size,
@@ -192,6 +454,14 @@ private:
           kc{std::forward<decltype(kc)>(kc)},
           vc{std::forward<decltype(vc)>(vc)}
     {
+        keyIndex.build(
+            populated, [this](std::size_t i) -> const Key& { return entries[i].first; },
+            [this](std::size_t i, std::size_t j)
+            { return compareKey(entries[i].first, entries[j].first); });
+        valueIndex.build(
+            populated, [this](std::size_t i) -> const Value& { return entries[i].second; },
+            [this](std::size_t i, std::size_t j)
+            { return compareValue(entries[i].second, entries[j].second); });
     }
 
     template <std::ranges::contiguous_range PairRange, std::size_t RangeSize>
@@ -277,15 +547,27 @@ public:
                  std::equivalence_relation<KeyComparator, K, Key>
     constexpr std::optional<std::reference_wrapper<const Value>> Find(const K& search) const
     {
-        for (std::size_t i = 0; i < this->populated; ++i)
+        if constexpr (decltype(keyIndex)::template indexes<K>)
         {
-            if (compareKey(this->entries[i].first, search))
+            const std::size_t i = keyIndex.find(search);
+            if (i < this->populated && compareKey(this->entries[i].first, search))
             {
                 return std::ref(this->entries[i].second);
             }
+            return std::nullopt;
         }
+        else
+        {
+            for (std::size_t i = 0; i < this->populated; ++i)
+            {
+                if (compareKey(this->entries[i].first, search))
+                {
+                    return std::ref(this->entries[i].second);
+                }
+            }
 
-        return std::nullopt;
+            return std::nullopt;
+        }
     }
 
     /*
@@ -296,15 +578,27 @@ public:
                  std::equivalence_relation<ValueComparator, V, Value>
     constexpr std::optional<std::reference_wrapper<const Key>> ReverseFind(const V& search) const
     {
-        for (std::size_t i = 0; i < this->populated; ++i)
+        if constexpr (decltype(valueIndex)::template indexes<V>)
         {
-            if (compareValue(this->entries[i].second, search))
+            const std::size_t i = valueIndex.find(search);
+            if (i < this->populated && compareValue(this->entries[i].second, search))
             {
                 return std::ref(this->entries[i].first);
             }
+            return std::nullopt;
         }
+        else
+        {
+            for (std::size_t i = 0; i < this->populated; ++i)
+            {
+                if (compareValue(this->entries[i].second, search))
+                {
+                    return std::ref(this->entries[i].first);
+                }
+            }
 
-        return std::nullopt;
+            return std::nullopt;
+        }
     }
 
     constexpr auto GetKeys() const
@@ -336,6 +630,9 @@ private:
     std::array<Entry, Size> entries;
     std::size_t populated;
 
+    BidirectionalMapInternals::LookupIndex<Key, KeyComparator, Size> keyIndex;
+    BidirectionalMapInternals::LookupIndex<Value, ValueComparator, Size> valueIndex;
+
     [[no_unique_address]] KeyComparator kc;
     [[no_unique_address]] ValueComparator vc;
 
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <bit>
+#include <stdint.h>
+#include <string_view>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define BYTESCAN_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BYTESCAN_SSE2
+#endif
+
+// Searches text for the first byte that is, or isn't, one of a handful of characters (optionally
+// along with every control character), a block of bytes at a time where the target has SSE2 or
+// AVX2 and a byte at a time otherwise
+namespace ByteScan
+{
+    namespace detail
+    {
+        template <bool controls, char... Cs>
+        constexpr bool isAnyOf(char c)
+        {
+            return (controls && uint8_t(c) < 0x20) || ((c == Cs) || ...);
+        }
+
+        // The first position at or after from whose byte's membership of Cs, plus the control
+        // characters if controls is set, is match
+        template <bool match, bool controls, char... Cs>
+        size_t scan(std::string_view data, size_t from)
+        {
+            const char* bytes = data.data();
+            const size_t size = data.size();
+            size_t i          = from;
+
+#ifdef BYTESCAN_AVX2
+            for (; i + 32 <= size; i += 32)
+            {
+                const __m256i block = _mm256_loadu_si256((const __m256i*)(bytes + i));
+                __m256i hits        = _mm256_setzero_si256();
+                if constexpr (controls)
+                {
+                    hits = _mm256_cmpeq_epi8(
+                        _mm256_min_epu8(block, _mm256_set1_epi8(0x1F)), block);
+                }
+                ((hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(Cs)))),
+                    ...);
+                uint32_t mask = uint32_t(_mm256_movemask_epi8(hits));
+                if constexpr (!match)
+                {
+                    mask = ~mask;
+                }
+                if (mask != 0)
+                {
+                    return i + std::countr_zero(mask);
+                }
+            }
+#endif
+#ifdef BYTESCAN_SSE2
+            for (; i + 16 <= size; i += 16)
+            {
+                const __m128i block = _mm_loadu_si128((const __m128i*)(bytes + i));
+                __m128i hits        = _mm_setzero_si128();
+                if constexpr (controls)
+                {
+                    hits = _mm_cmpeq_epi8(_mm_min_epu8(block, _mm_set1_epi8(0x1F)), block);
+                }
+                ((hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8(Cs)))), ...);
+                uint32_t mask = uint32_t(_mm_movemask_epi8(hits));
+                if constexpr (!match)
+                {
+                    mask ^= 0xFFFF;
+                }
+                if (mask != 0)
+                {
+                    return i + std::countr_zero(mask);
+                }
+            }
+#endif
+
+            for (; i < size; i++)
+            {
+                if (isAnyOf<controls, Cs...>(bytes[i]) == match)
+                {
+                    return i;
+                }
+            }
+            return size;
+        }
+    }
+
+    // The position of the first byte at or after from that is one of Cs, or data.size()
+    template <char... Cs>
+    size_t find(std::string_view data, size_t from)
+    {
+        return detail::scan<true, false, Cs...>(data, from);
+    }
+
+    // The position of the first byte at or after from that isn't one of Cs, or data.size()
+    template <char... Cs>
+    size_t skip(std::string_view data, size_t from)
+    {
+        return detail::scan<false, false, Cs...>(data, from);
+    }
+
+    // The position of the first byte at or after from that is a control character (below 0x20)
+    // or one of Cs, or data.size()
+    template <char... Cs>
+    size_t findControlOr(std::string_view data, size_t from)
+    {
+        return detail::scan<true, true, Cs...>(data, from);
+    }
+}
+
+#undef BYTESCAN_AVX2
+#undef BYTESCAN_SSE2
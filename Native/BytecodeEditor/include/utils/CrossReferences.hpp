@@ -0,0 +1,403 @@
+#pragma once
+
+#include "ASASM/ASProgram.hpp"
+#include "enums/OPCode.hpp"
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// Inverted index from the multinames, strings, classes and methods referenced by instructions to
+// the instructions referencing them. Built lazily on the first query.
+// Everything reachable from a script is attributed to that script (or to the first script reaching
+// it, for shared objects), and orphans to a pseudo-script keyed by nullptr. Invalidating a script
+// or class only reindexes the script owning it, and any other scripts sharing objects it no longer
+// reaches.
+class CrossReferences
+{
+public:
+    struct Usage
+    {
+        std::shared_ptr<ASASM::Method> method; // The method whose body contains the instruction
+        size_t instruction;
+    };
+
+private:
+    struct Owned
+    {
+        std::vector<std::shared_ptr<ASASM::Method>> methods;
+        std::vector<const ASASM::Class*> classes;
+
+        // Every key this owner's bodies contributed to, so they can be removed again
+        std::vector<ASASM::Multiname> multinameKeys;
+        std::vector<std::string> stringKeys;
+        std::vector<const ASASM::Class*> classKeys;
+        std::vector<const ASASM::Method*> methodKeys;
+
+        // Classes and methods this owner reached that were already owned by another
+        std::vector<const ASASM::Method*> sharedMethods;
+        std::vector<const ASASM::Class*> sharedClasses;
+    };
+
+    const ASASM::ASProgram& as;
+    bool built = false;
+
+    std::unordered_map<ASASM::Multiname, std::vector<Usage>> multinameUsages;
+    std::unordered_map<std::string, std::vector<Usage>> stringUsages;
+    std::unordered_map<const ASASM::Class*, std::vector<Usage>> classUsages;
+    std::unordered_map<const ASASM::Method*, std::vector<Usage>> methodUsages;
+
+    std::unordered_map<const ASASM::Script*, Owned> owned;
+    std::unordered_map<const ASASM::Method*, const ASASM::Script*> methodOwners;
+    std::unordered_map<const ASASM::Class*, const ASASM::Script*> classOwners;
+    // The other owners reaching each owned class or method, one of which has to take it over if its
+    // owner stops reaching it
+    std::unordered_map<const ASASM::Method*, std::unordered_set<const ASASM::Script*>>
+        methodSharers;
+    std::unordered_map<const ASASM::Class*, std::unordered_set<const ASASM::Script*>> classSharers;
+    std::unordered_set<const ASASM::Script*> dirty;
+
+    class Indexer
+    {
+        CrossReferences& refs;
+        const ASASM::Script* owner;
+        Owned& out;
+
+        template <typename Key>
+        void addUsage(std::unordered_map<Key, std::vector<Usage>>& usages, std::vector<Key>& keys,
+            const Key& key, const std::shared_ptr<ASASM::Method>& method, size_t instruction)
+        {
+            usages[key].emplace_back(method, instruction);
+            keys.emplace_back(key);
+        }
+
+        // Whether this owner takes the object, recording it as a sharer if someone else has it
+        template <typename T>
+        bool claim(std::unordered_map<const T*, const ASASM::Script*>& owners,
+            std::unordered_map<const T*, std::unordered_set<const ASASM::Script*>>& sharers,
+            std::vector<const T*>& shared, const T* object)
+        {
+            auto [found, inserted] = owners.try_emplace(object, owner);
+            if (!inserted && found->second != owner && sharers[object].emplace(owner).second)
+            {
+                shared.emplace_back(object);
+            }
+            return inserted;
+        }
+
+    public:
+        Indexer(CrossReferences& refs, const ASASM::Script* owner)
+            : refs(refs), owner(owner), out(refs.owned[owner])
+        {
+        }
+
+        void visitTraits(const std::vector<ASASM::Trait>& traits)
+        {
+            for (const auto& trait : traits)
+            {
+                switch (trait.kind)
+                {
+                    case TraitKind::Class:
+                        visitClass(trait.vClass().vclass);
+                        break;
+                    case TraitKind::Function:
+                        visitMethod(trait.vFunction().vfunction);
+                        break;
+                    case TraitKind::Method:
+                    case TraitKind::Getter:
+                    case TraitKind::Setter:
+                        visitMethod(trait.vMethod().vmethod);
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+
+        void visitClass(const std::shared_ptr<ASASM::Class>& vclass)
+        {
+            if (!vclass ||
+                !claim(refs.classOwners, refs.classSharers, out.sharedClasses, vclass.get()))
+            {
+                return;
+            }
+            out.classes.emplace_back(vclass.get());
+
+            visitMethod(vclass->cinit);
+            visitTraits(vclass->traits);
+            visitMethod(vclass->instance.iinit);
+            visitTraits(vclass->instance.traits);
+        }
+
+        void visitMethod(const std::shared_ptr<ASASM::Method>& method)
+        {
+            if (!method ||
+                !claim(refs.methodOwners, refs.methodSharers, out.sharedMethods, method.get()))
+            {
+                return;
+            }
+            out.methods.emplace_back(method);
+
+            if (!method->vbody)
+            {
+                return;
+            }
+
+            const auto& instructions = method->vbody->instructions;
+            for (size_t i = 0; i < instructions.size(); i++)
+            {
+                const auto& instruction = instructions[i];
+                const auto& argTypes    = OPCode_Info[(uint8_t)instruction.opcode].second;
+                for (size_t j = 0; j < argTypes.size(); j++)
+                {
+                    const auto& arg = instruction.arguments[j];
+                    switch (argTypes[j])
+                    {
+                        case OPCodeArgumentType::String:
+                            if (arg.stringv())
+                            {
+                                addUsage(refs.stringUsages, out.stringKeys, *arg.stringv(),
+                                    method, i);
+                            }
+                            break;
+                        case OPCodeArgumentType::Multiname:
+                            addUsage(refs.multinameUsages, out.multinameKeys, arg.multinamev(),
+                                method, i);
+                            break;
+                        case OPCodeArgumentType::Class:
+                            if (arg.classv())
+                            {
+                                addUsage(refs.classUsages, out.classKeys,
+                                    (const ASASM::Class*)arg.classv().get(), method, i);
+                                visitClass(arg.classv());
+                            }
+                            break;
+                        case OPCodeArgumentType::Method:
+                            if (arg.methodv())
+                            {
+                                addUsage(refs.methodUsages, out.methodKeys,
+                                    (const ASASM::Method*)arg.methodv().get(), method, i);
+                                visitMethod(arg.methodv());
+                            }
+                            break;
+                        default:
+                            break;
+                    }
+                }
+            }
+
+            visitTraits(method->vbody->traits);
+        }
+    };
+
+    template <typename Key>
+    static void dropUsages(std::unordered_map<Key, std::vector<Usage>>& usages,
+        const std::vector<Key>& keys, const std::unordered_set<const ASASM::Method*>& methods)
+    {
+        for (const auto& key : keys)
+        {
+            if (auto found = usages.find(key); found != usages.end())
+            {
+                std::erase_if(found->second,
+                    [&methods](const Usage& u) { return methods.contains(u.method.get()); });
+                if (found->second.empty())
+                {
+                    usages.erase(found);
+                }
+            }
+        }
+    }
+
+    template <typename T>
+    static void dropSharer(
+        std::unordered_map<const T*, std::unordered_set<const ASASM::Script*>>& sharers,
+        const std::vector<const T*>& shared, const ASASM::Script* owner)
+    {
+        for (const auto* object : shared)
+        {
+            if (auto found = sharers.find(object); found != sharers.end())
+            {
+                found->second.erase(owner);
+                if (found->second.empty())
+                {
+                    sharers.erase(found);
+                }
+            }
+        }
+    }
+
+    // Removes everything an owner contributed. The classes and methods it owned are added to the
+    // released lists.
+    void drop(const ASASM::Script* owner, std::vector<const ASASM::Method*>& releasedMethods,
+        std::vector<const ASASM::Class*>& releasedClasses)
+    {
+        auto found = owned.find(owner);
+        if (found == owned.end())
+        {
+            return;
+        }
+
+        std::unordered_set<const ASASM::Method*> methods;
+        for (const auto& method : found->second.methods)
+        {
+            methods.emplace(method.get());
+            methodOwners.erase(method.get());
+            releasedMethods.emplace_back(method.get());
+        }
+        for (const auto* vclass : found->second.classes)
+        {
+            classOwners.erase(vclass);
+            releasedClasses.emplace_back(vclass);
+        }
+        dropSharer(methodSharers, found->second.sharedMethods, owner);
+        dropSharer(classSharers, found->second.sharedClasses, owner);
+
+        dropUsages(multinameUsages, found->second.multinameKeys, methods);
+        dropUsages(stringUsages, found->second.stringKeys, methods);
+        dropUsages(classUsages, found->second.classKeys, methods);
+        dropUsages(methodUsages, found->second.methodKeys, methods);
+
+        owned.erase(found);
+    }
+
+    void index(const ASASM::Script* owner)
+    {
+        Indexer indexer(*this, owner);
+        if (owner)
+        {
+            indexer.visitMethod(owner->sinit);
+            indexer.visitTraits(owner->traits);
+        }
+        else
+        {
+            for (const auto& vclass : as.orphanClasses)
+            {
+                indexer.visitClass(vclass);
+            }
+            for (const auto& method : as.orphanMethods)
+            {
+                indexer.visitMethod(method);
+            }
+        }
+    }
+
+    void refresh()
+    {
+        if (!built)
+        {
+            for (const auto& script : as.scripts)
+            {
+                index(script.get());
+            }
+            index(nullptr);
+            built = true;
+            dirty.clear();
+            return;
+        }
+
+        // Objects a reindexed owner no longer reaches may still be reached by others, which only
+        // stopped at them because they were owned, so those get reindexed in turn
+        while (!dirty.empty())
+        {
+            const auto owners = std::exchange(dirty, {});
+
+            std::vector<const ASASM::Method*> releasedMethods;
+            std::vector<const ASASM::Class*> releasedClasses;
+            for (const auto* owner : owners)
+            {
+                drop(owner, releasedMethods, releasedClasses);
+            }
+            for (const auto* owner : owners)
+            {
+                index(owner);
+            }
+
+            requeueSharers(methodOwners, methodSharers, releasedMethods);
+            requeueSharers(classOwners, classSharers, releasedClasses);
+        }
+    }
+
+    // Marks the sharers of every released object nobody took back as dirty
+    template <typename T>
+    void requeueSharers(const std::unordered_map<const T*, const ASASM::Script*>& owners,
+        std::unordered_map<const T*, std::unordered_set<const ASASM::Script*>>& sharers,
+        const std::vector<const T*>& released)
+    {
+        for (const auto* object : released)
+        {
+            if (owners.contains(object))
+            {
+                continue;
+            }
+            if (auto found = sharers.find(object); found != sharers.end())
+            {
+                dirty.insert(found->second.begin(), found->second.end());
+                sharers.erase(found);
+            }
+        }
+    }
+
+    template <typename Key>
+    const std::vector<Usage>& find(
+        const std::unordered_map<Key, std::vector<Usage>>& usages, const Key& key)
+    {
+        static const std::vector<Usage> none;
+
+        if (auto found = usages.find(key); found != usages.end())
+        {
+            return found->second;
+        }
+        return none;
+    }
+
+public:
+    explicit CrossReferences(const ASASM::ASProgram& as) : as(as) {}
+
+    // Marks a script as changed. Also used for newly added scripts.
+    void invalidate(const ASASM::Script* script)
+    {
+        if (built)
+        {
+            dirty.emplace(script);
+        }
+    }
+
+    // Marks the script that owns a class as changed
+    void invalidate(const ASASM::Class* vclass)
+    {
+        if (built)
+        {
+            if (auto found = classOwners.find(vclass); found != classOwners.end())
+            {
+                dirty.emplace(found->second);
+            }
+        }
+    }
+
+    const std::vector<Usage>& usagesOf(const ASASM::Multiname& name)
+    {
+        refresh();
+        return find(multinameUsages, name);
+    }
+
+    const std::vector<Usage>& usagesOf(const std::string& string)
+    {
+        refresh();
+        return find(stringUsages, string);
+    }
+
+    const std::vector<Usage>& usagesOf(const ASASM::Class* vclass)
+    {
+        refresh();
+        return find(classUsages, vclass);
+    }
+
+    const std::vector<Usage>& usagesOf(const ASASM::Method* method)
+    {
+        refresh();
+        return find(methodUsages, method);
+    }
+};
@@ -0,0 +1,185 @@
+#pragma once
+
+#include "utils/ProjectArchive.hpp"
+#include "utils/StringException.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Receives the files of a disassembly as they are finished, so that they don't all have to be held
+// in memory at once. Files are written one at a time, each before any file that includes it; the
+// main file comes last, followed by a call to finish().
+class DisassemblySink
+{
+public:
+    virtual ~DisassemblySink() = default;
+
+    virtual void write(const std::string& filename, std::string&& contents) = 0;
+
+    virtual void finish() {}
+};
+
+// Collects the files into a map of file name to file contents
+class MapSink : public DisassemblySink
+{
+public:
+    std::unordered_map<std::string, std::string> files;
+
+    void write(const std::string& filename, std::string&& contents) override
+    {
+        files.insert_or_assign(filename, std::move(contents));
+    }
+};
+
+// Writes the files into a directory tree, creating directories as needed
+class DirectorySink : public DisassemblySink
+{
+private:
+    std::filesystem::path root;
+
+public:
+    explicit DirectorySink(std::filesystem::path root) : root(std::move(root)) {}
+
+    void write(const std::string& filename, std::string&& contents) override
+    {
+        // File names are UTF-8
+        const std::filesystem::path path =
+            root / std::u8string_view((const char8_t*)filename.data(), filename.size());
+        std::filesystem::create_directories(path.parent_path());
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out.write(contents.data(), contents.size()))
+        {
+            throw StringException("Could not write " + filename);
+        }
+    }
+};
+
+// Writes the files into an uncompressed POSIX (pax) tar archive
+class TarSink : public DisassemblySink
+{
+private:
+    static constexpr size_t BLOCK_SIZE = 512;
+
+    std::ofstream out;
+
+    // Writes v as a NUL-terminated, zero-padded octal number filling the field
+    static void writeOctal(char* field, size_t fieldSize, uint64_t v)
+    {
+        field[fieldSize - 1] = '\0';
+        for (size_t i = fieldSize - 1; i-- > 0; v >>= 3)
+        {
+            field[i] = char('0' + (v & 7));
+        }
+    }
+
+    void writeHeader(std::string_view name, char type, uint64_t size)
+    {
+        std::array<char, BLOCK_SIZE> header{};
+        std::memcpy(header.data(), name.data(), std::min<size_t>(name.size(), 100));
+        writeOctal(header.data() + 100, 8, 0644); // mode
+        writeOctal(header.data() + 108, 8, 0);    // uid
+        writeOctal(header.data() + 116, 8, 0);    // gid
+        writeOctal(header.data() + 124, 12, size);
+        writeOctal(header.data() + 136, 12, 0); // mtime
+        header[156] = type;
+        std::memcpy(header.data() + 257, "ustar", 6);
+        std::memcpy(header.data() + 263, "00", 2);
+
+        // The checksum is computed with its own field filled with spaces
+        std::memset(header.data() + 148, ' ', 8);
+        unsigned int checksum = 0;
+        for (char c : header)
+        {
+            checksum += (unsigned char)c;
+        }
+        writeOctal(header.data() + 148, 7, checksum);
+
+        out.write(header.data(), header.size());
+    }
+
+    void writeData(std::string_view data)
+    {
+        static constexpr std::array<char, BLOCK_SIZE> padding{};
+
+        out.write(data.data(), data.size());
+        out.write(padding.data(), (BLOCK_SIZE - data.size() % BLOCK_SIZE) % BLOCK_SIZE);
+    }
+
+public:
+    explicit TarSink(const std::filesystem::path& path)
+        : out(path, std::ios::binary | std::ios::trunc)
+    {
+        if (!out)
+        {
+            throw StringException("Could not open archive for writing");
+        }
+    }
+
+    void write(const std::string& filename, std::string&& contents) override
+    {
+        if (filename.size() > 100)
+        {
+            // Too long for the header, so it's given by an extended header record instead. The
+            // record's length includes the digits of the length itself.
+            const size_t recordSize = filename.size() + sizeof(" path=\n") - 1;
+            size_t length           = recordSize + 1;
+            while (std::to_string(length).size() + recordSize != length)
+            {
+                length = std::to_string(length).size() + recordSize;
+            }
+            const std::string record = std::to_string(length) + " path=" + filename + '\n';
+
+            writeHeader("PaxHeader", 'x', record.size());
+            writeData(record);
+        }
+
+        writeHeader(filename, '0', contents.size());
+        writeData(contents);
+
+        if (!out)
+        {
+            throw StringException("Could not write " + filename);
+        }
+    }
+
+    void finish() override
+    {
+        // Two zero blocks mark the end of the archive
+        static constexpr std::array<char, BLOCK_SIZE * 2> end{};
+        out.write(end.data(), end.size());
+        out.flush();
+
+        if (!out)
+        {
+            throw StringException("Could not finish writing archive");
+        }
+    }
+};
+
+// Writes the files into a disassembly archive; see ProjectArchive
+class ArchiveSink : public DisassemblySink
+{
+private:
+    ProjectArchiveWriter writer;
+
+public:
+    explicit ArchiveSink(const std::filesystem::path& path, bool compress = true)
+        : writer(path, compress)
+    {
+    }
+
+    void write(const std::string& filename, std::string&& contents) override
+    {
+        writer.add(filename, contents);
+    }
+
+    void finish() override { writer.finish(); }
+};
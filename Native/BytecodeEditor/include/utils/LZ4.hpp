@@ -0,0 +1,193 @@
+#pragma once
+
+#include "utils/StringException.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The LZ4 block format: fast to decompress, and roughly halves the size of ASASM text. Blocks
+// carry no header, so the decompressed size has to be stored alongside them.
+namespace LZ4
+{
+    inline std::string compress(std::string_view src)
+    {
+        constexpr size_t MIN_MATCH     = 4;
+        constexpr size_t LAST_LITERALS = 5;  // the block always ends with this many literals
+        constexpr size_t MF_LIMIT      = 12; // and no match starts in its last this many bytes
+        constexpr size_t MAX_OFFSET    = 65535;
+        constexpr unsigned HASH_BITS   = 16;
+
+        const auto load32 = [&src](size_t i)
+        {
+            uint32_t v;
+            std::memcpy(&v, src.data() + i, sizeof(v));
+            return v;
+        };
+
+        std::string out;
+        out.reserve(src.size() / 2 + 16);
+
+        const auto writeLength = [&out](size_t length)
+        {
+            for (; length >= 255; length -= 255)
+            {
+                out.push_back(char(255));
+            }
+            out.push_back(char(length));
+        };
+
+        const auto writeLiterals = [&](size_t from, size_t to, uint8_t matchNibble)
+        {
+            const size_t length = to - from;
+            out.push_back(char((std::min<size_t>(length, 15) << 4) | matchNibble));
+            if (length >= 15)
+            {
+                writeLength(length - 15);
+            }
+            out.append(src.data() + from, length);
+        };
+
+        size_t anchor = 0;
+        if (src.size() > MF_LIMIT)
+        {
+            // Positions plus one of the last occurrence of each 4-byte sequence's hash
+            std::vector<uint32_t> table(size_t(1) << HASH_BITS, 0);
+            const size_t matchEnd = src.size() - LAST_LITERALS;
+
+            size_t i = 0;
+            while (i + MF_LIMIT <= src.size())
+            {
+                const uint32_t sequence = load32(i);
+                const uint32_t hash     = (sequence * 2654435761u) >> (32 - HASH_BITS);
+                const size_t candidate  = table[hash];
+                table[hash]             = uint32_t(i + 1);
+
+                if (candidate == 0 || i - (candidate - 1) > MAX_OFFSET ||
+                    load32(candidate - 1) != sequence)
+                {
+                    i++;
+                    continue;
+                }
+
+                size_t match  = candidate - 1;
+                size_t length = MIN_MATCH;
+                while (i + length < matchEnd && src[match + length] == src[i + length])
+                {
+                    length++;
+                }
+                while (i > anchor && match > 0 && src[i - 1] == src[match - 1])
+                {
+                    i--;
+                    match--;
+                    length++;
+                }
+
+                const size_t offset      = i - match;
+                const size_t matchLength = length - MIN_MATCH;
+                writeLiterals(anchor, i, uint8_t(std::min<size_t>(matchLength, 15)));
+                out.push_back(char(offset & 0xFF));
+                out.push_back(char(offset >> 8));
+                if (matchLength >= 15)
+                {
+                    writeLength(matchLength - 15);
+                }
+
+                i      += length;
+                anchor  = i;
+            }
+        }
+        writeLiterals(anchor, src.size(), 0);
+
+        return out;
+    }
+
+    inline std::string decompress(std::string_view src, size_t size)
+    {
+        constexpr size_t MIN_MATCH = 4;
+
+        std::string out(size, '\0');
+        size_t in      = 0;
+        size_t written = 0;
+
+        const auto readLength = [&](size_t length)
+        {
+            if (length == 15)
+            {
+                uint8_t b;
+                do
+                {
+                    if (in >= src.size())
+                    {
+                        throw StringException("Truncated compressed data");
+                    }
+                    b       = uint8_t(src[in++]);
+                    length += b;
+                }
+                while (b == 255);
+            }
+            return length;
+        };
+
+        while (true)
+        {
+            if (in >= src.size())
+            {
+                throw StringException("Truncated compressed data");
+            }
+            const uint8_t token = uint8_t(src[in++]);
+
+            const size_t literals = readLength(token >> 4);
+            if (literals > src.size() - in || literals > size - written)
+            {
+                throw StringException("Corrupt compressed data");
+            }
+            std::memcpy(out.data() + written, src.data() + in, literals);
+            in      += literals;
+            written += literals;
+
+            if (in == src.size())
+            {
+                break;
+            }
+
+            if (src.size() - in < 2)
+            {
+                throw StringException("Truncated compressed data");
+            }
+            const size_t offset = uint8_t(src[in]) | (size_t(uint8_t(src[in + 1])) << 8);
+            in                 += 2;
+            const size_t length = readLength(token & 15) + MIN_MATCH;
+            if (offset == 0 || offset > written || length > size - written)
+            {
+                throw StringException("Corrupt compressed data");
+            }
+
+            char* dest       = out.data() + written;
+            const char* from = dest - offset;
+            if (offset >= length)
+            {
+                std::memcpy(dest, from, length);
+            }
+            else
+            {
+                // Overlapping copies repeat the last offset bytes
+                for (size_t i = 0; i < length; i++)
+                {
+                    dest[i] = from[i];
+                }
+            }
+            written += length;
+        }
+
+        if (written != size)
+        {
+            throw StringException("Corrupt compressed data");
+        }
+
+        return out;
+    }
+}
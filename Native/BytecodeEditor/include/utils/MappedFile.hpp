@@ -0,0 +1,116 @@
+#pragma once
+
+#include "utils/StringException.hpp"
+
+#include <filesystem>
+#include <span>
+#include <stdint.h>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// A whole file mapped read-only into memory
+class MappedFile
+{
+private:
+    const uint8_t* data = nullptr;
+    size_t size         = 0;
+
+#ifdef _WIN32
+    HANDLE file    = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+    void close() noexcept
+    {
+#ifdef _WIN32
+        if (data)
+        {
+            UnmapViewOfFile(data);
+        }
+        if (mapping)
+        {
+            CloseHandle(mapping);
+        }
+        if (file != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(file);
+        }
+        file    = INVALID_HANDLE_VALUE;
+        mapping = nullptr;
+#else
+        if (data)
+        {
+            munmap((void*)data, size);
+        }
+#endif
+        data = nullptr;
+        size = 0;
+    }
+
+public:
+    explicit MappedFile(const std::filesystem::path& path)
+    {
+#ifdef _WIN32
+        file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL, nullptr);
+        LARGE_INTEGER fileSize;
+        if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize))
+        {
+            close();
+            throw StringException("Could not open " + path.string());
+        }
+        size = size_t(fileSize.QuadPart);
+        // Empty files can't be mapped
+        if (size != 0)
+        {
+            mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            data    = mapping ? (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)
+                              : nullptr;
+            if (!data)
+            {
+                close();
+                throw StringException("Could not map " + path.string());
+            }
+        }
+#else
+        const int fd = open(path.c_str(), O_RDONLY);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0)
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+            throw StringException("Could not open " + path.string());
+        }
+        size = size_t(info.st_size);
+        if (size != 0)
+        {
+            void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED)
+            {
+                ::close(fd);
+                size = 0;
+                throw StringException("Could not map " + path.string());
+            }
+            data = (const uint8_t*)mapped;
+        }
+        ::close(fd);
+#endif
+    }
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() { close(); }
+
+    std::span<const uint8_t> bytes() const { return {data, size}; }
+};
@@ -0,0 +1,205 @@
+#pragma once
+
+#include "utils/StringException.hpp"
+
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+// Persistent cache of disassembled instruction listings, keyed by a hash of everything the listing
+// depends on. It lives in a directory of its own as a single file of (key, text) records. Each
+// session writes the records it uses to a new file, which replaces the old one on save(), so
+// entries for code that has gone away are dropped rather than accumulating.
+class MethodBodyCache
+{
+public:
+    using Key = std::array<uint64_t, 2>;
+
+    // Bump whenever the disassembler's output changes, which invalidates existing caches
+    static constexpr uint32_t FORMAT_VERSION = 1;
+
+    // Two lanes of MurmurHash64A over the key material, with different seeds and multipliers, as
+    // 64 bits would leave a collision, which silently gives a method the wrong code, within reach
+    // of large caches
+    static Key hash(std::string_view data)
+    {
+        constexpr Key m = {0xc6a4a7935bd1e995ull, 0x9fb21c651e98df25ull};
+
+        Key h = {0x9e3779b97f4a7c15ull, 0x6a09e667f3bcc909ull};
+        for (size_t lane = 0; lane < h.size(); lane++)
+        {
+            h[lane] ^= data.size() * m[lane];
+        }
+
+        const auto mix = [&h, &m](uint64_t word)
+        {
+            for (size_t lane = 0; lane < h.size(); lane++)
+            {
+                uint64_t k  = word * m[lane];
+                k          ^= k >> 47;
+                k          *= m[lane];
+                h[lane]    ^= k;
+                h[lane]    *= m[lane];
+            }
+        };
+
+        size_t i = 0;
+        for (; i + 8 <= data.size(); i += 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, data.data() + i, 8);
+            mix(word);
+        }
+        if (i < data.size())
+        {
+            uint64_t word = 0;
+            std::memcpy(&word, data.data() + i, data.size() - i);
+            mix(word);
+        }
+
+        for (size_t lane = 0; lane < h.size(); lane++)
+        {
+            h[lane] ^= h[lane] >> 47;
+            h[lane] *= m[lane];
+            h[lane] ^= h[lane] >> 47;
+        }
+        return h;
+    }
+
+private:
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const noexcept { return size_t(key[0]); }
+    };
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+    };
+
+    static constexpr Header HEADER = {{'A', 'S', 'A', 'S', 'M', 'B', 'C', '\0'}, FORMAT_VERSION};
+
+    std::filesystem::path file, newFile;
+
+    std::mutex mutex;
+    std::ifstream in;
+    std::ofstream out;
+    // Where each record of the old file's text starts, and its length
+    std::unordered_map<Key, std::pair<uint64_t, uint32_t>, KeyHash> index;
+    std::unordered_set<Key, KeyHash> written;
+
+    void writeRecord(const Key& key, std::string_view text)
+    {
+        if (written.insert(key).second)
+        {
+            const uint32_t size = uint32_t(text.size());
+            out.write((const char*)key.data(), sizeof(key));
+            out.write((const char*)&size, sizeof(size));
+            out.write(text.data(), text.size());
+        }
+    }
+
+public:
+    explicit MethodBodyCache(const std::filesystem::path& directory)
+        : file(directory / "bodies.cache"), newFile(directory / "bodies.cache.new")
+    {
+        std::filesystem::create_directories(directory);
+
+        in.open(file, std::ios::binary);
+        Header header;
+        if (in.read((char*)&header, sizeof(header)) &&
+            std::memcmp(&header, &HEADER, sizeof(header)) == 0)
+        {
+            // A record cut short ends the index
+            const uint64_t fileSize = std::filesystem::file_size(file);
+            Key key;
+            uint32_t size;
+            while (in.read((char*)key.data(), sizeof(key)) && in.read((char*)&size, sizeof(size)))
+            {
+                const uint64_t start = uint64_t(in.tellg());
+                if (start + size > fileSize)
+                {
+                    break;
+                }
+                index.try_emplace(key, start, size);
+                in.seekg(size, std::ios::cur);
+            }
+            in.clear();
+        }
+        else
+        {
+            in.close();
+        }
+
+        out.open(newFile, std::ios::binary | std::ios::trunc);
+        if (!out.write((const char*)&HEADER, sizeof(HEADER)))
+        {
+            throw StringException("Could not write method body cache");
+        }
+    }
+
+    MethodBodyCache(const MethodBodyCache&)            = delete;
+    MethodBodyCache& operator=(const MethodBodyCache&) = delete;
+
+    ~MethodBodyCache()
+    {
+        if (out.is_open())
+        {
+            out.close();
+            std::error_code ignored;
+            std::filesystem::remove(newFile, ignored);
+        }
+    }
+
+    // Safe to call concurrently with find and store
+    std::optional<std::string> find(const Key& key)
+    {
+        std::lock_guard lock(mutex);
+
+        auto found = index.find(key);
+        if (found == index.end())
+        {
+            return std::nullopt;
+        }
+
+        std::string text(found->second.second, '\0');
+        if (!in.seekg(found->second.first) || !in.read(text.data(), text.size()))
+        {
+            in.clear();
+            return std::nullopt;
+        }
+        writeRecord(key, text);
+        return text;
+    }
+
+    // Safe to call concurrently with find and store
+    void store(const Key& key, std::string_view text)
+    {
+        std::lock_guard lock(mutex);
+        writeRecord(key, text);
+    }
+
+    // Replaces the cache with the records found or stored since it was opened. The cache can't be
+    // used afterwards.
+    void save()
+    {
+        std::lock_guard lock(mutex);
+
+        out.close();
+        if (!out)
+        {
+            throw StringException("Could not write method body cache");
+        }
+        in.close();
+        std::filesystem::rename(newFile, file);
+    }
+};
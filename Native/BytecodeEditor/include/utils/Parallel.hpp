@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Parallel
+{
+    inline size_t workerCount(size_t jobs)
+    {
+        return std::min<size_t>(jobs, std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    // Calls f(i) for every i in [0, count) across the available hardware threads. Indices are
+    // handed out dynamically, so f must only touch state owned by its own index. The first
+    // exception thrown by any call is rethrown on the calling thread once all workers are done.
+    template <typename F>
+    void forEach(size_t count, F&& f)
+    {
+        const size_t workers = workerCount(count);
+        if (workers <= 1)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                f(i);
+            }
+            return;
+        }
+
+        std::atomic<size_t> next = 0;
+        std::exception_ptr error = nullptr;
+        std::mutex errorMutex;
+
+        const auto work = [&]
+        {
+            try
+            {
+                for (size_t i = next++; i < count; i = next++)
+                {
+                    f(i);
+                }
+            }
+            catch (...)
+            {
+                std::lock_guard lock(errorMutex);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+                // Stop handing out work; remaining results would be discarded anyway
+                next = count;
+            }
+        };
+
+        {
+            std::vector<std::jthread> threads;
+            threads.reserve(workers - 1);
+            for (size_t i = 1; i < workers; i++)
+            {
+                threads.emplace_back(work);
+            }
+            work();
+        }
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+}
@@ -0,0 +1,291 @@
+#pragma once
+
+#include "utils/LZ4.hpp"
+#include "utils/MappedFile.hpp"
+#include "utils/StringException.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A disassembled project stored as one file (.basasm). Its header points at an index of every
+// file's name, position and size, sorted by name, so files can be looked up in place once the
+// archive is mapped into memory, without reading or splitting anything up front. Each file's data
+// is either stored as is or compressed with LZ4.
+//
+// Layout, all integers little-endian:
+//     Header
+//     file data, in the order the files were written
+//     names, concatenated without separators
+//     Entry[fileCount], 8-byte aligned and sorted by name
+namespace ProjectArchiveFormat
+{
+    inline constexpr char MAGIC[8]              = {'A', 'S', 'A', 'S', 'M', 'P', 'K', '\0'};
+    inline constexpr uint32_t VERSION           = 1;
+    inline constexpr std::string_view EXTENSION = ".basasm";
+
+    enum class Compression : uint32_t
+    {
+        None = 0,
+        LZ4  = 1,
+    };
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t fileCount;
+        uint64_t indexOffset;
+    };
+
+    struct Entry
+    {
+        uint64_t nameOffset;
+        uint64_t dataOffset;
+        uint64_t storedSize;
+        uint64_t size;
+        uint32_t nameLength;
+        Compression compression;
+    };
+
+    static_assert(sizeof(Header) == 24 && sizeof(Entry) == 40);
+}
+
+// Writes an archive one file at a time. The index is written by finish(), so an archive that was
+// never finished isn't valid.
+class ProjectArchiveWriter
+{
+private:
+    std::ofstream out;
+    bool compress;
+    uint64_t offset = sizeof(ProjectArchiveFormat::Header);
+    std::vector<ProjectArchiveFormat::Entry> entries;
+    std::string names;
+
+    void write(const void* data, size_t size)
+    {
+        out.write((const char*)data, size);
+        offset += size;
+    }
+
+public:
+    // Files are compressed when compress is set, unless that wouldn't make them smaller
+    ProjectArchiveWriter(const std::filesystem::path& path, bool compress = true)
+        : out(path, std::ios::binary | std::ios::trunc), compress(compress)
+    {
+        const ProjectArchiveFormat::Header placeholder{};
+        out.write((const char*)&placeholder, sizeof(placeholder));
+        if (!out)
+        {
+            throw StringException("Could not open archive for writing");
+        }
+    }
+
+    void add(std::string_view name, std::string_view contents)
+    {
+        ProjectArchiveFormat::Entry entry{};
+        entry.nameOffset  = names.size();
+        entry.nameLength  = uint32_t(name.size());
+        entry.dataOffset  = offset;
+        entry.size        = contents.size();
+        entry.compression = ProjectArchiveFormat::Compression::None;
+        names.append(name);
+
+        std::string compressed;
+        if (compress)
+        {
+            compressed = LZ4::compress(contents);
+        }
+        if (compress && compressed.size() < contents.size())
+        {
+            entry.compression = ProjectArchiveFormat::Compression::LZ4;
+            entry.storedSize  = compressed.size();
+            write(compressed.data(), compressed.size());
+        }
+        else
+        {
+            entry.storedSize = contents.size();
+            write(contents.data(), contents.size());
+        }
+        entries.emplace_back(entry);
+
+        if (!out)
+        {
+            throw StringException("Could not write " + std::string(name));
+        }
+    }
+
+    void finish()
+    {
+        const uint64_t namesOffset = offset;
+        write(names.data(), names.size());
+
+        static constexpr char padding[8] = {};
+        write(padding, (8 - offset % 8) % 8);
+
+        // Name offsets were relative to the start of the names until now
+        for (auto& entry : entries)
+        {
+            entry.nameOffset += namesOffset;
+        }
+        std::sort(entries.begin(), entries.end(),
+            [this, namesOffset](const auto& a, const auto& b)
+            {
+                return std::string_view(names).substr(a.nameOffset - namesOffset, a.nameLength) <
+                       std::string_view(names).substr(b.nameOffset - namesOffset, b.nameLength);
+            });
+        const auto duplicate = std::adjacent_find(entries.begin(), entries.end(),
+            [this, namesOffset](const auto& a, const auto& b)
+            {
+                return std::string_view(names).substr(a.nameOffset - namesOffset, a.nameLength) ==
+                       std::string_view(names).substr(b.nameOffset - namesOffset, b.nameLength);
+            });
+        if (duplicate != entries.end())
+        {
+            throw StringException("Archive contains " +
+                                  names.substr(duplicate->nameOffset - namesOffset,
+                                      duplicate->nameLength) +
+                                  " twice");
+        }
+
+        ProjectArchiveFormat::Header header{};
+        std::memcpy(header.magic, ProjectArchiveFormat::MAGIC, sizeof(header.magic));
+        header.version     = ProjectArchiveFormat::VERSION;
+        header.fileCount   = uint32_t(entries.size());
+        header.indexOffset = offset;
+        write(entries.data(), entries.size() * sizeof(ProjectArchiveFormat::Entry));
+
+        out.seekp(0);
+        out.write((const char*)&header, sizeof(header));
+        out.flush();
+        if (!out)
+        {
+            throw StringException("Could not finish writing archive");
+        }
+    }
+};
+
+// A finished archive, mapped into memory. Opening it only checks the index; files are
+// decompressed the first time they're asked for.
+class ProjectArchive
+{
+private:
+    MappedFile file;
+    std::span<const ProjectArchiveFormat::Entry> entries;
+
+    // Contents of compressed files, filled in on first use
+    std::unique_ptr<std::string[]> decompressed;
+    std::unique_ptr<std::once_flag[]> decompressedOnce;
+
+    std::string_view bytesAt(uint64_t offset, uint64_t size) const
+    {
+        return {(const char*)file.bytes().data() + offset, size_t(size)};
+    }
+
+public:
+    explicit ProjectArchive(const std::filesystem::path& path) : file(path)
+    {
+        const std::span<const uint8_t> bytes = file.bytes();
+
+        ProjectArchiveFormat::Header header;
+        if (bytes.size() < sizeof(header))
+        {
+            throw StringException("Not a disassembly archive");
+        }
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        if (std::memcmp(header.magic, ProjectArchiveFormat::MAGIC, sizeof(header.magic)) != 0)
+        {
+            throw StringException("Not a disassembly archive");
+        }
+        if (header.version != ProjectArchiveFormat::VERSION)
+        {
+            throw StringException("Unsupported disassembly archive version " +
+                                  std::to_string(header.version));
+        }
+        if (header.indexOffset % alignof(ProjectArchiveFormat::Entry) != 0 ||
+            header.indexOffset > bytes.size() ||
+            (bytes.size() - header.indexOffset) / sizeof(ProjectArchiveFormat::Entry) <
+                header.fileCount)
+        {
+            throw StringException("Corrupt disassembly archive index");
+        }
+
+        // The mapping is page-aligned, so the index can be used in place
+        entries = {(const ProjectArchiveFormat::Entry*)(bytes.data() + header.indexOffset),
+            header.fileCount};
+
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            const auto& entry = entries[i];
+            if (entry.nameOffset > bytes.size() ||
+                entry.nameLength > bytes.size() - entry.nameOffset ||
+                entry.dataOffset > bytes.size() ||
+                entry.storedSize > bytes.size() - entry.dataOffset ||
+                (entry.compression == ProjectArchiveFormat::Compression::None &&
+                    entry.storedSize != entry.size) ||
+                (entry.compression != ProjectArchiveFormat::Compression::None &&
+                    entry.compression != ProjectArchiveFormat::Compression::LZ4) ||
+                (i != 0 && name(i - 1) >= name(i)))
+            {
+                throw StringException("Corrupt disassembly archive index");
+            }
+        }
+
+        decompressed     = std::make_unique<std::string[]>(entries.size());
+        decompressedOnce = std::make_unique<std::once_flag[]>(entries.size());
+    }
+
+    size_t size() const { return entries.size(); }
+
+    std::string_view name(size_t i) const
+    {
+        return bytesAt(entries[i].nameOffset, entries[i].nameLength);
+    }
+
+    // The contents of the i-th file by name. Views of stored files point into the mapping; both
+    // kinds stay valid as long as the archive. Safe to call concurrently.
+    std::string_view contents(size_t i) const
+    {
+        const auto& entry = entries[i];
+        const std::string_view stored = bytesAt(entry.dataOffset, entry.storedSize);
+        if (entry.compression == ProjectArchiveFormat::Compression::None)
+        {
+            return stored;
+        }
+
+        std::call_once(decompressedOnce[i],
+            [&] { decompressed[i] = LZ4::decompress(stored, size_t(entry.size)); });
+        return decompressed[i];
+    }
+
+    std::optional<std::string_view> find(std::string_view fileName) const
+    {
+        size_t low = 0, high = entries.size();
+        while (low < high)
+        {
+            const size_t mid = low + (high - low) / 2;
+            if (name(mid) < fileName)
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+        if (low == entries.size() || name(low) != fileName)
+        {
+            return std::nullopt;
+        }
+        return contents(low);
+    }
+};
@@ -10,6 +10,8 @@
 #include <cassert>
 #include <ctype.h>
 #include <list>
+#include <memory>
+#include <optional>
 #include <stdio.h>
 #include <unordered_map>
 #include <unordered_set>
@@ -119,13 +121,56 @@ public:
         };
 
     private:
+        // What an item expands to, worked out the first time it's needed and then shared by all
+        // its copies. Expansion only depends on an item's value and on contexts which are fixed
+        // before anything is expanded. Items that expand to themselves don't get one.
+        struct SharedExpansion
+        {
+            std::shared_ptr<std::optional<std::vector<ContextItem>>> items;
+
+            // Takes no part in comparing items
+            auto operator<=>(const SharedExpansion&) const noexcept
+            {
+                return std::strong_ordering::equal;
+            }
+            bool operator==(const SharedExpansion&) const noexcept { return true; }
+        };
+
         mutable bool expanding = false;
         std::variant<ASASM::Multiname, StrData, GroupData> data;
+        SharedExpansion expansion;
+
+        std::vector<ContextItem> memoize(
+            std::vector<ContextItem>&& items, bool nestedCycle, bool& hitCycle) const
+        {
+            if (nestedCycle)
+            {
+                hitCycle = true;
+                return std::move(items);
+            }
+            *expansion.items = std::move(items);
+            return **expansion.items;
+        }
+
+        bool expandsToItself() const
+        {
+            return !expanding && (type == Type::String ||
+                                     (type == Type::Multiname &&
+                                         std::get<ASASM::Multiname>(data).kind == ABCType::QName &&
+                                         std::get<ASASM::Multiname>(data).qname().ns.kind !=
+                                             ABCType::PrivateNamespace));
+        }
 
     public:
         Type type;
 
         std::vector<ContextItem> reduceGroup(const RefBuilder& refs) const
+        {
+            bool hitCycle = false;
+            return reduceGroup(refs, hitCycle);
+        }
+
+        std::vector<ContextItem> reduceGroup(const RefBuilder& refs, bool& hitCycle) const
         {
             if (type != Type::Group)
             {
@@ -135,7 +180,7 @@ public:
             std::vector<std::vector<ContextItem>> contexts;
             for (const auto& ctx : std::get<GroupData>(data).group)
             {
-                contexts.emplace_back(ContextItem::expand(refs, {ctx}));
+                contexts.emplace_back(ContextItem::expand(refs, {ctx}, hitCycle));
             }
 
             std::vector<ContextItem> ctx;
@@ -217,11 +262,25 @@ public:
 
         static std::vector<ContextItem> expand(
             const RefBuilder& refs, const std::vector<ContextItem>& context)
+        {
+            bool hitCycle = false;
+            return expand(refs, context, hitCycle);
+        }
+
+        // Sets hitCycle if any item was reached again while it was being expanded. What it then
+        // expands to is only a stand-in for that caller, so nothing depending on it is memoized.
+        static std::vector<ContextItem> expand(
+            const RefBuilder& refs, const std::vector<ContextItem>& context, bool& hitCycle)
         {
             std::vector<ContextItem> newContext;
             for (const auto& c : context)
             {
-                std::vector<ContextItem> add = c.expand(refs);
+                if (c.expandsToItself())
+                {
+                    newContext.emplace_back(c);
+                    continue;
+                }
+                std::vector<ContextItem> add = c.expand(refs, hitCycle);
                 if (!add.empty())
                 {
                     newContext.insert(newContext.end(), add.begin(), add.end());
@@ -230,8 +289,13 @@ public:
             return newContext;
         }
 
-        std::vector<ContextItem> expand(const RefBuilder& refs) const
+        std::vector<ContextItem> expand(const RefBuilder& refs, bool& hitCycle) const
         {
+            if (expansion.items && *expansion.items)
+            {
+                return **expansion.items;
+            }
+
             if (expanding)
             {
                 switch (type)
@@ -244,6 +308,7 @@ public:
                                               "an expanding multiname");
                     }
                     case Type::Group:
+                        hitCycle = true;
                         return {ContextItem(std::get<GroupData>(data).groupFallback)};
                 }
             }
@@ -263,6 +328,7 @@ public:
             };
 
             ExpandingScopeGuard esg = {expanding};
+            bool nestedCycle        = false;
 
             switch (type)
             {
@@ -276,13 +342,13 @@ public:
                             const auto& ns = multiname.qname().ns;
                             if (ns.kind == ABCType::PrivateNamespace)
                             {
-                                auto ctx =
-                                    refs.namespaces[(uint8_t)ns.kind].getContext(refs, ns.id);
+                                auto ctx = refs.namespaces[(uint8_t)ns.kind].getContext(
+                                    refs, ns.id, nestedCycle);
                                 if (multiname.qname().name)
                                 {
                                     ctx.emplace_back(*multiname.qname().name);
                                 }
-                                return ctx;
+                                return memoize(std::move(ctx), nestedCycle, hitCycle);
                             }
                         }
                         break;
@@ -299,14 +365,20 @@ public:
                 case Type::String:
                     break;
                 case Type::Group:
-                    return reduceGroup(refs);
+                    return memoize(reduceGroup(refs, nestedCycle), nestedCycle, hitCycle);
             }
             // This copy needs to be not expanding
             expanding = false;
             return {*this};
         }
 
-        ContextItem(const ASASM::Multiname& m) : type(Type::Multiname), data(m) {}
+        ContextItem(const ASASM::Multiname& m) : type(Type::Multiname), data(m)
+        {
+            if (m.kind == ABCType::QName && m.qname().ns.kind == ABCType::PrivateNamespace)
+            {
+                expansion.items = std::make_shared<std::optional<std::vector<ContextItem>>>();
+            }
+        }
 
         ContextItem(const std::string& s, bool filenameSuffix = false)
             : type(Type::String), data(StrData{s, filenameSuffix})
@@ -319,7 +391,9 @@ public:
         }
 
         ContextItem(const std::vector<ContextItem>& group, const std::string& groupFallback)
-            : type(Type::Group), data(GroupData{group, groupFallback})
+            : type(Type::Group),
+              data(GroupData{group, groupFallback}),
+              expansion{std::make_shared<std::optional<std::vector<ContextItem>>>()}
         {
         }
 
@@ -525,15 +599,34 @@ public:
         }
     };
 
+    // Contexts are recorded as immutable lists, shared by every object met in the same context
+    using SharedContext = std::shared_ptr<const std::vector<ContextItem>>;
+
     std::vector<ContextItem> context;
+    // The current context as last recorded, until it changes
+    SharedContext sharedContext;
+
+    const SharedContext& currentContext()
+    {
+        if (!sharedContext)
+        {
+            sharedContext = std::make_shared<const std::vector<ContextItem>>(context);
+        }
+        return sharedContext;
+    }
 
     template <typename... Ts>
     void pushContext(Ts... args)
     {
         context.emplace_back(args...);
+        sharedContext.reset();
     }
 
-    void popContext() { context.pop_back(); }
+    void popContext()
+    {
+        context.pop_back();
+        sharedContext.reset();
+    }
 
     enum class ContextPriority : uint8_t
     {
@@ -548,7 +641,7 @@ public:
     {
         using T = std::remove_cvref_t<t>;
         mutable std::unordered_map<T, std::vector<ContextItem>> contexts;
-        std::unordered_map<T, std::array<std::vector<std::vector<ContextItem>>, 3>> contextSets;
+        std::unordered_map<T, std::array<std::vector<SharedContext>, 3>> contextSets;
 #ifndef NDEBUG
         mutable bool contextsSealed = false;
         mutable bool coagulated     = false;
@@ -556,7 +649,7 @@ public:
 
         std::unordered_map<T, std::string> names, filenames;
 
-        bool add(T obj, const std::vector<ContextItem>& context, ContextPriority priority)
+        bool add(T obj, const SharedContext& context, ContextPriority priority)
         {
             assert(!coagulated);
             assert(!contextsSealed);
@@ -564,7 +657,8 @@ public:
             if (auto found = contextSets.find(obj); found != contextSets.end())
             {
                 auto& pet = found->second[(uint8_t)priority];
-                if (pet.size() == 0 || pet[pet.size() - 1] != context)
+                if (pet.size() == 0 ||
+                    (pet[pet.size() - 1] != context && *pet[pet.size() - 1] != *context))
                 {
                     pet.emplace_back(context);
                 }
@@ -577,7 +671,7 @@ public:
             }
         }
 
-        bool addIfNew(T obj, const std::vector<ContextItem>& context, ContextPriority priority)
+        bool addIfNew(T obj, const SharedContext& context, ContextPriority priority)
         {
             if (isAdded(obj))
             {
@@ -608,8 +702,9 @@ public:
 
             for (const auto& obj : contexts)
             {
-                std::string bname     = refs.contextToString(obj.second, false);
-                std::string bfilename = refs.contextToString(obj.second, true);
+                const auto ctx        = refs.simplifyContext(obj.second);
+                std::string bname     = refs.contextToString(ctx, false);
+                std::string bfilename = refs.contextToString(ctx, true);
                 int counter = collisionCounter.contains(bname) ? collisionCounter.at(bname) : 0;
                 if (counter == 1)
                 {
@@ -636,51 +731,77 @@ public:
 #endif
         }
 
-        std::vector<ContextItem> getContext(const RefBuilder& refs, T obj) const
+        const std::vector<ContextItem>& getContext(const RefBuilder& refs, T obj) const
+        {
+#ifndef NDEBUG
+            contextsSealed = true;
+#endif
+
+            if (!contexts.contains(obj))
+            {
+                bool hitCycle = false;
+                contexts[obj] = expandContext(refs, obj, hitCycle);
+            }
+            return contexts.at(obj);
+        }
+
+        // For use while expanding another item; see ContextItem::expand
+        std::vector<ContextItem> getContext(const RefBuilder& refs, T obj, bool& hitCycle) const
         {
 #ifndef NDEBUG
             contextsSealed = true;
 #endif
 
-            if (contexts.contains(obj))
+            if (auto found = contexts.find(obj); found != contexts.end())
             {
-                return contexts.at(obj);
+                return found->second;
             }
 
-            std::vector<std::vector<ContextItem>> set;
+            bool nestedCycle             = false;
+            std::vector<ContextItem> ctx = expandContext(refs, obj, nestedCycle);
+            if (nestedCycle)
+            {
+                hitCycle = true;
+                return ctx;
+            }
+            return contexts[obj] = std::move(ctx);
+        }
+
+        std::vector<ContextItem> expandContext(const RefBuilder& refs, T obj, bool& hitCycle) const
+        {
+            const std::vector<SharedContext>* found = nullptr;
 
             for (const auto& prioritySet : contextSets.at(obj))
             {
                 if (!prioritySet.empty())
                 {
-                    set = prioritySet;
+                    found = &prioritySet;
                     break;
                 }
             }
+            const std::vector<SharedContext>& set = *found;
 
             if constexpr (ALLOW_DUPLICATES)
             {
-                std::vector<ContextItem> ctx = ContextItem::expand(refs, set[0]);
+                std::vector<ContextItem> ctx = ContextItem::expand(refs, *set[0], hitCycle);
                 for (size_t i = 1; i < set.size(); i++)
                 {
-                    auto expanded = ContextItem::expand(refs, set[i]);
+                    auto expanded = ContextItem::expand(refs, *set[i], hitCycle);
                     ctx           = ContextItem::contextRoot(ctx, expanded);
                 }
-                contexts[obj] = ctx;
+                return ctx;
             }
             else
             {
                 if (set.size() > 1)
                 {
-                    contexts[obj] = {ContextItem("multireferenced")};
+                    return {ContextItem("multireferenced")};
                 }
                 else
                 {
-                    contexts[obj] = ContextItem::expand(refs, set[0]);
+                    return ContextItem::expand(refs, *set[0], hitCycle);
                 }
             }
-
-            return contexts.at(obj);
         }
 
         std::string getName(T obj)
@@ -772,10 +893,12 @@ public:
             context = {
                 {classContexts, "script_" + std::to_string(i)}
             };
-            scripts.add(&as.scripts[i], context, ContextPriority::declaration);
+            sharedContext.reset();
+            scripts.add(&as.scripts[i], currentContext(), ContextPriority::declaration);
             pushContext("init", true);
             addMethod(as.scripts[i]->sinit, ContextPriority::declaration);
             context.clear();
+            sharedContext.reset();
         }
 
         for (size_t i = 0; i < as.orphanClasses.size(); i++)
@@ -806,7 +929,9 @@ public:
                 if (trait.name.kind == ABCType::QName)
                 {
                     namespaces[(uint8_t)trait.name.qname().ns.kind].addIfNew(
-                        trait.name.qname().ns.id, scripts.getContext(*this, (const void*)&script),
+                        trait.name.qname().ns.id,
+                        std::make_shared<const std::vector<ContextItem>>(
+                            scripts.getContext(*this, (const void*)&script)),
                         ContextPriority::declaration);
                 }
             }
@@ -818,7 +943,7 @@ public:
             {
                 pushContext("orphan_namespace_" + std::to_string(i));
                 namespaces[(uint8_t)ABCType::PrivateNamespace].add(
-                    i, context, ContextPriority::orphan);
+                    i, currentContext(), ContextPriority::orphan);
                 popContext();
             }
         }
@@ -918,8 +1043,11 @@ public:
             return;
         }
 
-        std::vector<ContextItem> myContext{context.begin(), context.begin() + myPos};
-        namespaces[(uint8_t)ns.kind].add(ns.id, myContext, priority);
+        namespaces[(uint8_t)ns.kind].add(ns.id,
+            myPos == context.size() ? currentContext()
+                                    : std::make_shared<const std::vector<ContextItem>>(
+                                          context.begin(), context.begin() + myPos),
+            priority);
     }
 
     void visitNamespaceSet(const std::vector<ASASM::Namespace>& nsSet, ContextPriority priority)
@@ -1001,12 +1129,14 @@ public:
         }
     }
 
-    std::string contextToString(std::vector<ContextItem> ctx, bool filename) const
+    // Expands a context and merges neighboring items that repeat each other, which is all that
+    // contextToString needs done for both names and file names
+    std::vector<ContextItem> simplifyContext(const std::vector<ContextItem>& context) const
     {
-        ctx = ContextItem::expand(*this, ctx);
+        std::vector<ContextItem> ctx = ContextItem::expand(*this, context);
         if (ctx.empty())
         {
-            return "";
+            return ctx;
         }
 
         for (size_t i = ctx.size() - 1; i > 0; i--)
@@ -1020,6 +1150,16 @@ public:
                 ctx = std::move(newContext);
             }
         }
+        return ctx;
+    }
+
+    // Takes a context from simplifyContext
+    std::string contextToString(const std::vector<ContextItem>& ctx, bool filename) const
+    {
+        if (ctx.empty())
+        {
+            return "";
+        }
 
         std::vector<ContextItem::Segment> segments;
         for (const auto& ci : ctx)
@@ -1113,7 +1253,7 @@ public:
     template <typename T>
     bool addObject(T obj, ContextPriority priority)
     {
-        return objects.add(obj.get(), context, priority);
+        return objects.add(obj.get(), currentContext(), priority);
     }
 
     void addClass(const std::shared_ptr<ASASM::Class> vclass, ContextPriority priority)
@@ -1,24 +1,63 @@
 #pragma once
 
-#include <sstream>
+#include <charconv>
+#include <concepts>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 
-class StringBuilder : public std::stringstream
+// Append-only text buffer. Streaming follows iostream conventions (character types are written as
+// characters, other integers as decimal numbers), without going through locales or a streambuf.
+class StringBuilder
 {
+private:
+    std::string buffer;
+
 public:
     bool indented = false;
     int indent    = 0;
     std::string linePrefix;
 
+    StringBuilder& operator<<(char c)
+    {
+        buffer.push_back(c);
+        return *this;
+    }
+
+    StringBuilder& operator<<(signed char c) { return *this << char(c); }
+
+    StringBuilder& operator<<(unsigned char c) { return *this << char(c); }
+
+    StringBuilder& operator<<(const char* str) { return *this << std::string_view(str); }
+
+    StringBuilder& operator<<(std::string_view str)
+    {
+        buffer.append(str);
+        return *this;
+    }
+
+    template <std::integral T>
+        requires(!std::is_same_v<T, bool> && !std::is_same_v<T, char> &&
+                 !std::is_same_v<T, signed char> && !std::is_same_v<T, unsigned char>)
+    StringBuilder& operator<<(T v)
+    {
+        char digits[24];
+        const auto result = std::to_chars(digits, digits + sizeof(digits), v);
+        buffer.append(digits, result.ptr);
+        return *this;
+    }
+
     template <typename T>
-    void write(T v)
+    void write(const T& v)
     {
         checkIndent();
-        *this << std::forward<T>(v);
+        *this << v;
     }
 
     void newLine()
     {
-        *this << '\n';
+        buffer.push_back('\n');
         indented = false;
     }
 
@@ -33,8 +72,13 @@ public:
             indented = true;
             if (!linePrefix.empty())
             {
-                *this << linePrefix;
+                buffer.append(linePrefix);
             }
         }
     }
+
+    [[nodiscard]] const std::string& str() const { return buffer; }
+
+    // Moves the text out, leaving the builder empty
+    [[nodiscard]] std::string release() { return std::exchange(buffer, std::string()); }
 };
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "ASASM/ASProgram.hpp"
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// Hashed lookup from script-level trait names to the scripts (and classes) declaring them.
+// Lookups give the same answers as scanning ASProgram::scripts in order; any change to a script's
+// trait list must be followed by a call to update() for that script.
+class SymbolIndex
+{
+private:
+    struct Declaration
+    {
+        size_t scriptOrder;
+        std::shared_ptr<ASASM::Script> script;
+        std::shared_ptr<ASASM::Class> clazz; // Only set for class traits
+    };
+
+    struct IndexedScript
+    {
+        size_t order;
+        std::vector<ASASM::Multiname> names;
+    };
+
+    std::unordered_map<ASASM::Multiname, std::vector<Declaration>> declarations;
+    std::unordered_map<const ASASM::Script*, IndexedScript> indexedScripts;
+    std::map<size_t, std::shared_ptr<ASASM::Script>> scriptsInOrder;
+    size_t nextOrder = 0;
+
+    mutable std::optional<std::vector<ASASM::Multiname>> classNamesCache;
+    mutable std::optional<std::vector<ASASM::Multiname>> scriptNamesCache;
+
+    void unindex(const ASASM::Script* script, const IndexedScript& indexed)
+    {
+        for (const auto& name : indexed.names)
+        {
+            if (auto found = declarations.find(name); found != declarations.end())
+            {
+                std::erase_if(found->second,
+                    [script](const Declaration& d) { return d.script.get() == script; });
+                if (found->second.empty())
+                {
+                    declarations.erase(found);
+                }
+            }
+        }
+    }
+
+public:
+    SymbolIndex() = default;
+
+    explicit SymbolIndex(const ASASM::ASProgram& program) { build(program); }
+
+    void build(const ASASM::ASProgram& program)
+    {
+        declarations.clear();
+        indexedScripts.clear();
+        scriptsInOrder.clear();
+        nextOrder = 0;
+
+        for (const auto& script : program.scripts)
+        {
+            update(script);
+        }
+    }
+
+    // (Re)indexes a script's traits. Scripts not seen before are treated as appended to the
+    // program.
+    void update(const std::shared_ptr<ASASM::Script>& script)
+    {
+        auto [indexed, inserted] = indexedScripts.try_emplace(script.get(), IndexedScript{});
+        if (inserted)
+        {
+            indexed->second.order = nextOrder++;
+            scriptsInOrder.emplace(indexed->second.order, script);
+        }
+        else
+        {
+            unindex(script.get(), indexed->second);
+            indexed->second.names.clear();
+        }
+
+        const size_t order = indexed->second.order;
+        for (const auto& trait : script->traits)
+        {
+            auto& decls = declarations[trait.name];
+            // Keep declarations sorted by script order so the first match is the one a linear scan
+            // would have found
+            auto insertAt = std::upper_bound(decls.begin(), decls.end(), order,
+                [](size_t o, const Declaration& d) { return o < d.scriptOrder; });
+            decls.emplace(insertAt, order, script,
+                trait.kind == TraitKind::Class ? trait.vClass().vclass : nullptr);
+            indexed->second.names.emplace_back(trait.name);
+        }
+
+        classNamesCache  = std::nullopt;
+        scriptNamesCache = std::nullopt;
+    }
+
+    [[nodiscard]] std::shared_ptr<ASASM::Class> getClass(const ASASM::Multiname& name) const
+    {
+        if (auto found = declarations.find(name); found != declarations.end())
+        {
+            for (const auto& decl : found->second)
+            {
+                if (decl.clazz)
+                {
+                    return decl.clazz;
+                }
+            }
+        }
+
+        return nullptr;
+    }
+
+    [[nodiscard]] std::shared_ptr<ASASM::Script> getScript(const ASASM::Multiname& name) const
+    {
+        if (auto found = declarations.find(name); found != declarations.end())
+        {
+            return found->second.front().script;
+        }
+
+        return nullptr;
+    }
+
+    // Names of every class trait, in program order
+    [[nodiscard]] const std::vector<ASASM::Multiname>& classNames() const
+    {
+        if (!classNamesCache)
+        {
+            classNamesCache.emplace();
+            for (const auto& [order, script] : scriptsInOrder)
+            {
+                for (const auto& trait : script->traits)
+                {
+                    if (trait.kind == TraitKind::Class)
+                    {
+                        classNamesCache->emplace_back(trait.name);
+                    }
+                }
+            }
+        }
+
+        return *classNamesCache;
+    }
+
+    // Name of the first trait of every script that has one, in program order
+    [[nodiscard]] const std::vector<ASASM::Multiname>& scriptNames() const
+    {
+        if (!scriptNamesCache)
+        {
+            scriptNamesCache.emplace();
+            for (const auto& [order, script] : scriptsInOrder)
+            {
+                if (!script->traits.empty())
+                {
+                    scriptNamesCache->emplace_back(script->traits[0].name);
+                }
+            }
+        }
+
+        return *scriptNamesCache;
+    }
+};
@@ -2,15 +2,20 @@
 
 #include "ASASM/Multiname.hpp"
 #include "ASASM/Namespace.hpp"
+#include "utils/StringException.hpp"
 #include <algorithm>
 #include <bit>
 #include <cassert>
 #include <cmath>
-#include <map>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <queue>
 #include <stdint.h>
 #include <string>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 template <typename T, bool haveNull>
 class ValuePoolBase
@@ -18,7 +23,7 @@ class ValuePoolBase
 public:
     using Key = std::remove_cvref_t<T>;
 
-    static Key toKey(T val) { return val; }
+    static const Key& toKey(const T& val) { return val; }
 };
 
 template <bool haveNull>
@@ -48,6 +53,33 @@ private:
     using Key = ValuePoolBase<T, haveNull>::Key;
     using ValuePoolBase<T, haveNull>::toKey;
 
+    static size_t hashOf(const Key& key) noexcept
+    {
+        if constexpr (std::is_same_v<Key, std::vector<ASASM::Namespace>>)
+        {
+            size_t ret = key.size();
+            for (const auto& ns : key)
+            {
+                ret = hash_combine(ret, std::hash<ASASM::Namespace>{}(ns));
+            }
+            return ret;
+        }
+        else if constexpr (std::is_same_v<Key, ASASM::Metadata>)
+        {
+            size_t ret = std::hash<std::optional<std::string>>{}(key.name);
+            for (const auto& [k, v] : key.data)
+            {
+                ret = hash_combine(ret, std::hash<std::optional<std::string>>{}(k));
+                ret = hash_combine(ret, std::hash<std::optional<std::string>>{}(v));
+            }
+            return ret;
+        }
+        else
+        {
+            return std::hash<Key>{}(key);
+        }
+    }
+
     template <typename V>
     static constexpr bool isNull(V v)
     {
@@ -104,37 +136,204 @@ public:
     {
         uint32_t hits{};
         T value{};
+        size_t hash{};
         size_t addIndex{}, index{};
-        std::vector<Key> parents{};
+        std::vector<size_t> parents{}; // addIndex of every entry that must come before this one
     };
 
-    std::map<Key, Entry> pool;
-    std::vector<T> values;
+private:
+    // Every distinct value, in the order it was first added
+    std::vector<Entry> entries;
+
+    // Open-addressed table of entries positions plus one; zero marks an empty slot. Hashes are kept
+    // in the entries, so a lookup computes one hash and growing never rehashes a key.
+    std::vector<uint32_t> slots;
+    unsigned int slotShift = std::numeric_limits<size_t>::digits;
 
-    bool add(const T& value)
+    size_t home(size_t hash) const noexcept
     {
-        if constexpr (haveNull || std::is_pointer_v<Key>)
+        // Fibonacci hashing: the top bits of the product depend on every bit of the hash, which
+        // matters for pointer keys whose low bits are always zero
+        return (hash * size_t(0x9E3779B97F4A7C15ull)) >> slotShift;
+    }
+
+    // Returns the slot holding key, or the empty slot where it belongs
+    size_t probe(const Key& key, size_t hash) const noexcept
+    {
+        const size_t mask = slots.size() - 1;
+        for (size_t slot = home(hash);; slot = (slot + 1) & mask)
         {
-            if (isNull(value))
+            if (slots[slot] == 0)
             {
-                return false;
+                return slot;
+            }
+            const Entry& e = entries[slots[slot] - 1];
+            if (e.hash == hash && toKey(e.value) == key)
+            {
+                return slot;
+            }
+        }
+    }
+
+    const Entry* find(const Key& key) const noexcept
+    {
+        if (slots.empty())
+        {
+            return nullptr;
+        }
+        const size_t slot = probe(key, hashOf(key));
+        return slots[slot] == 0 ? nullptr : &entries[slots[slot] - 1];
+    }
+
+    Entry* find(const Key& key) noexcept
+    {
+        return const_cast<Entry*>(std::as_const(*this).find(key));
+    }
+
+    // Keeps the table at most half full once another entry is added
+    void reserveSlot()
+    {
+        if ((entries.size() + 1) * 2 <= slots.size())
+        {
+            return;
+        }
+
+        slots.assign(std::max<size_t>(16, slots.size() * 2), 0);
+        slotShift = std::numeric_limits<size_t>::digits - std::countr_zero(slots.size());
+        const size_t mask = slots.size() - 1;
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            size_t slot = home(entries[i].hash);
+            while (slots[slot] != 0)
+            {
+                slot = (slot + 1) & mask;
             }
+            slots[slot] = uint32_t(i + 1);
         }
+    }
 
-        auto key = toKey(value);
-        if (pool.contains(key))
+    // Counts hits visits to value. Returns true if it was already pooled; otherwise adds it only
+    // if insert is set.
+    bool visit(const T& value, bool insert, uint32_t hits = 1)
+    {
+        if (insert)
+        {
+            reserveSlot();
+        }
+        else if (slots.empty())
         {
-            pool[key].hits++;
             return false;
         }
-        else
+
+        decltype(auto) key = toKey(value);
+        const size_t hash  = hashOf(key);
+        const size_t slot  = probe(key, hash);
+        if (slots[slot] != 0)
         {
-            pool.emplace(key, Entry{1, value, pool.size(), 0, {}});
+            entries[slots[slot] - 1].hits += hits;
             return true;
         }
+
+        if (insert)
+        {
+            slots[slot] = uint32_t(entries.size() + 1);
+            entries.emplace_back(hits, value, hash, entries.size(), 0);
+        }
+        return false;
     }
 
-    bool notAdded(const T& value)
+    // Topological sort (Kahn's algorithm) of entries ranked best first. Each entry is ranked by
+    // its position, but a parent is pulled forward to the rank of its best-ranked dependent so that
+    // frequently used values aren't held back by their parents. When every parent is already ranked
+    // before its dependents, the ranking is kept as is. Sets every entry's index.
+    void sortTopologically(std::vector<Entry*>& all)
+    {
+        std::vector<size_t> rank(entries.size());
+        for (size_t i = 0; i < all.size(); i++)
+        {
+            rank[all[i]->addIndex] = i;
+        }
+
+        std::vector<std::vector<size_t>> children(entries.size());
+        std::vector<size_t> parentCount(entries.size());
+        for (const auto& entry : entries)
+        {
+            for (size_t parent : entry.parents)
+            {
+                // A class naming itself as its own base needs no reordering
+                if (parent != entry.addIndex)
+                {
+                    children[parent].emplace_back(entry.addIndex);
+                    parentCount[entry.addIndex]++;
+                }
+            }
+        }
+
+        const auto kahn = [&](auto&& ready, const auto& key)
+        {
+            std::vector<size_t> pending = parentCount;
+            std::vector<size_t> order;
+            order.reserve(entries.size());
+            for (size_t i = 0; i < entries.size(); i++)
+            {
+                if (pending[i] == 0)
+                {
+                    ready.emplace(key(i), i);
+                }
+            }
+            while (!ready.empty())
+            {
+                const size_t next = ready.top().second;
+                ready.pop();
+                order.emplace_back(next);
+                for (size_t child : children[next])
+                {
+                    if (--pending[child] == 0)
+                    {
+                        ready.emplace(key(child), child);
+                    }
+                }
+            }
+            if (order.size() != entries.size())
+            {
+                throw StringException("Circular dependency between pooled values");
+            }
+            return order;
+        };
+
+        using Ready = std::pair<size_t, size_t>;
+        const auto byRank = [&rank](size_t i) { return rank[i]; };
+        std::vector<size_t> pulledRank(rank);
+        {
+            // Children always follow their parents here, so walking backwards settles every
+            // child's rank before its parents read it
+            const auto order = kahn(
+                std::priority_queue<Ready, std::vector<Ready>, std::greater<Ready>>{}, byRank);
+            for (auto it = order.rbegin(); it != order.rend(); ++it)
+            {
+                for (size_t child : children[*it])
+                {
+                    pulledRank[*it] = std::min(pulledRank[*it], pulledRank[child]);
+                }
+            }
+        }
+
+        using PulledReady = std::pair<std::pair<size_t, size_t>, size_t>;
+        const auto order  = kahn(
+            std::priority_queue<PulledReady, std::vector<PulledReady>, std::greater<PulledReady>>{},
+            [&](size_t i) { return std::pair{pulledRank[i], rank[i]}; });
+
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            all[i]        = &entries[order[i]];
+            all[i]->index = i;
+        }
+    }
+
+public:
+    std::vector<T> values;
+
+    bool add(const T& value, uint32_t hits = 1)
     {
         if constexpr (haveNull || std::is_pointer_v<Key>)
         {
@@ -144,39 +343,48 @@ public:
             }
         }
 
-        auto key = toKey(value);
-        if (pool.contains(key))
+        return !visit(value, true, hits);
+    }
+
+    bool notAdded(const T& value)
+    {
+        if constexpr (haveNull || std::is_pointer_v<Key>)
         {
-            pool[key].hits++;
-            return false;
+            if (isNull(value))
+            {
+                return false;
+            }
         }
-        return true;
+
+        return !visit(value, false);
     }
 
     void registerDependency(const T& _from, const T& _to)
     {
-        auto from = toKey(_from);
-        auto to   = toKey(_to);
+        Entry* from     = find(toKey(_from));
+        const Entry* to = find(toKey(_to));
 
-        assert(pool.contains(from));
-        assert(pool.contains(to));
+        assert(from != nullptr);
+        assert(to != nullptr);
 
-        auto& fromV = pool[from];
+        assert(std::none_of(from->parents.begin(), from->parents.end(),
+            [to](size_t p) { return p == to->addIndex; }));
 
-        assert(std::none_of(
-            fromV.parents.begin(), fromV.parents.end(), [to](const Key& k) { return k == to; }));
-
-        fromV.parents.emplace_back(to);
+        from->parents.emplace_back(to->addIndex);
     }
 
+    // Every pooled value with its hits, in the order it was first added
+    const std::vector<Entry>& getEntries() const { return entries; }
+
+    // Every pooled value, in the order it was first added
     std::vector<T> getPreliminaryValues() const
     {
         std::vector<T> ret;
-        ret.reserve(pool.size());
+        ret.reserve(entries.size());
 
-        for (const auto& pair : pool)
+        for (const auto& entry : entries)
         {
-            ret.emplace_back(pair.second.value);
+            ret.emplace_back(entry.value);
         }
 
         return ret;
@@ -185,11 +393,11 @@ public:
     std::vector<T>& finalize()
     {
         std::vector<Entry*> all;
-        all.reserve(pool.size());
+        all.reserve(entries.size());
 
-        for (auto& pair : pool)
+        for (auto& entry : entries)
         {
-            all.emplace_back(&pair.second);
+            all.emplace_back(&entry);
         }
 
         if constexpr (std::is_same_v<T, double>)
@@ -215,43 +423,97 @@ public:
             std::sort(all.begin(), all.end(), sortPred);
         }
 
-    // topographical sort
-    topSort:
+        sortTopologically(all);
 
-        for (size_t i = 0; i < all.size(); i++)
+        values.reserve(all.size() + (haveNull ? 1 : 0));
+        if constexpr (haveNull)
         {
-            all[i]->index = i;
+            values.emplace_back();
         }
 
-        for (const auto& a : pool)
+        for (const Entry* e : all)
         {
-            for (const auto& parent : a.second.parents)
+            values.emplace_back(e->value);
+        }
+
+        return values;
+    }
+
+    // Bytes taken by a U30 holding v
+    static constexpr size_t u30Size(uint64_t v) noexcept
+    {
+        return v < 0x80 ? 1 : v < 0x4000 ? 2 : v < 0x20'00'00 ? 3 : v < 0x10'00'00'00 ? 4 : 5;
+    }
+
+    // Reorders a finalized pool so that references to it take as few bytes as possible, given how
+    // many times each index of values is referenced. Without dependencies, ranking by reference
+    // count is optimal; with them, parents are pulled in just ahead of their best-ranked dependent.
+    // The new order is only kept if it is smaller. Returns whether values changed.
+    bool minimizeReferenceSize(const std::vector<uint64_t>& references)
+    {
+        constexpr size_t offset = haveNull ? 1 : 0;
+
+        // Every index fits in a byte either way
+        if (entries.size() + offset <= 0x80)
+        {
+            return false;
+        }
+
+        std::vector<uint64_t> weights(entries.size());
+        std::vector<size_t> oldIndices(entries.size());
+        for (const auto& entry : entries)
+        {
+            const size_t index         = entry.index + offset;
+            weights[entry.addIndex]    = index < references.size() ? references[index] : 0;
+            oldIndices[entry.addIndex] = entry.index;
+        }
+
+        const auto encodedSize = [&]
+        {
+            uint64_t ret = 0;
+            for (const auto& entry : entries)
             {
-                assert(pool.contains(parent));
-                if (pool[parent].index > a.second.index)
-                {
-                    all.erase(all.begin() + pool[parent].index);
-                    all.insert(all.begin() + a.second.index, &pool[parent]);
-                    goto topSort;
-                }
+                ret += weights[entry.addIndex] * u30Size(entry.index + offset);
             }
+            return ret;
+        };
+
+        const uint64_t oldSize = encodedSize();
+
+        std::vector<Entry*> all;
+        all.reserve(entries.size());
+        for (auto& entry : entries)
+        {
+            all.emplace_back(&entry);
         }
+        std::sort(all.begin(), all.end(),
+            [&weights](const Entry* a, const Entry* b)
+            {
+                return weights[a->addIndex] > weights[b->addIndex] ||
+                       (weights[a->addIndex] == weights[b->addIndex] && a->index < b->index);
+            });
 
-        values.reserve(all.size() + (haveNull ? 1 : 0));
-        if constexpr (haveNull)
+        sortTopologically(all);
+
+        if (encodedSize() >= oldSize)
         {
-            values.emplace_back();
+            for (auto& entry : entries)
+            {
+                entry.index = oldIndices[entry.addIndex];
+            }
+            return false;
         }
 
+        values.resize(offset);
         for (const Entry* e : all)
         {
             values.emplace_back(e->value);
         }
 
-        return values;
+        return true;
     }
 
-    uint32_t get(const T& value)
+    uint32_t get(const T& value) const
     {
         if constexpr (haveNull)
         {
@@ -260,6 +522,9 @@ public:
                 return 0;
             }
         }
-        return pool[toKey(value)].index + (haveNull ? 1 : 0);
+        // Values that were never pooled, such as a null method in a pool without a null entry, map
+        // to the first index
+        const Entry* found = find(toKey(value));
+        return (found ? found->index : 0) + (haveNull ? 1 : 0);
     }
 };
@@ -2,6 +2,11 @@
 
 #include <functional>
 
+constexpr size_t hash_combine(size_t seed, size_t value) noexcept
+{
+    return seed ^ value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
 template <typename T, auto MemberPointer, auto... MemberPointers>
     requires requires(T v) {
                  v.*MemberPointer;
@@ -9,9 +14,6 @@ template <typename T, auto MemberPointer, auto... MemberPointers>
              }
 constexpr size_t generic_hash(const T& val) noexcept
 {
-    static constexpr auto hash_combine = [](size_t seed, size_t value)
-    { return seed ^ value + 0x9e3779b9 + (seed << 6) + (seed >> 2); };
-
     if constexpr (sizeof...(MemberPointers) == 0)
     {
         return std::hash<std::remove_cvref_t<decltype(val.*MemberPointer)>>{}(val.*MemberPointer);
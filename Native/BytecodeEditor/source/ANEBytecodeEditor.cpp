@@ -36,28 +36,45 @@ void ContextInitializer(void*, const uint8_t* ctxTypeRaw, FREContext ctx, uint32
             {(const uint8_t*)"AsyncTaskResult",      context, &TZA<&BE::taskResult>               },
             {(const uint8_t*)"InsertABCToSWF",       context, &InsertABCToSWF                     },
             {(const uint8_t*)"Cleanup",              context, &Cleanup                            },
+            {(const uint8_t*)"SetMinimizePoolSizes", context, &SetMinimizePoolSizes               },
+            {(const uint8_t*)"SetDisassemblyCache",  context, &SetDisassemblyCache                },
+            {(const uint8_t*)"SetParseCache",        context, &SetParseCache                      },
             {(const uint8_t*)"GetClass",             context, &GetClass                           },
             {(const uint8_t*)"GetScript",            context, &GetScript                          },
             {(const uint8_t*)"CreateScript",         context, &CreateScript                       },
             {(const uint8_t*)"ListClasses",          context, &TZA<&BE::listClasses>              },
             {(const uint8_t*)"ListScripts",          context, &TZA<&BE::listScripts>              },
+            {(const uint8_t*)"FindMultinameUsages",  context, &FindMultinameUsages                },
+            {(const uint8_t*)"FindStringUsages",     context, &FindStringUsages                   },
+            {(const uint8_t*)"FindClassUsages",      context, &FindClassUsages                    },
+            {(const uint8_t*)"DisassembleToPath",    context,
+             &DisassembleToPath<&BE::disassembleToPath>                                           },
+            {(const uint8_t*)"DisassembleToPathAsync", context,
+             &DisassembleToPath<&BE::disassembleToPathAsync>                                      },
+            {(const uint8_t*)"AssembleFromPath",     context,
+             &AssembleFromPath<&BE::assembleFromPath>                                             },
+            {(const uint8_t*)"AssembleFromPathAsync", context,
+             &AssembleFromPath<&BE::assembleFromPathAsync>                                        },
         });
 
         *functions    = context->functions.get();
-        *numFunctions = 16;
+        *numFunctions = 26;
     }
     else if (ctxType == "SWFIntrospector"sv)
     {
         context->editor    = std::shared_ptr<BytecodeEditor>(new BytecodeEditor(ctx));
         context->functions = std::unique_ptr<FRENamedFunction[]>(new FRENamedFunction[]{
-            {(const uint8_t*)"BeginIntrospection", context, &Disassemble<&BE::beginIntrospection>},
-            {(const uint8_t*)"GetClass",           context, &GetROClass                          },
-            {(const uint8_t*)"GetScript",          context, &GetROScript                         },
-            {(const uint8_t*)"ListClasses",        context, &TZA<&BE::listClasses>               },
-            {(const uint8_t*)"ListScripts",        context, &TZA<&BE::listScripts>               },
+            {(const uint8_t*)"BeginIntrospection",  context, &Disassemble<&BE::beginIntrospection>},
+            {(const uint8_t*)"GetClass",            context, &GetROClass                          },
+            {(const uint8_t*)"GetScript",           context, &GetROScript                         },
+            {(const uint8_t*)"ListClasses",         context, &TZA<&BE::listClasses>               },
+            {(const uint8_t*)"ListScripts",         context, &TZA<&BE::listScripts>               },
+            {(const uint8_t*)"FindMultinameUsages", context, &FindMultinameUsages                 },
+            {(const uint8_t*)"FindStringUsages",    context, &FindStringUsages                    },
+            {(const uint8_t*)"FindClassUsages",     context, &FindClassUsages                     },
         });
         *functions         = context->functions.get();
-        *numFunctions      = 5;
+        *numFunctions      = 8;
     }
     else if (ctxType == "Class"sv)
     {
@@ -87,13 +104,14 @@ void ContextInitializer(void*, const uint8_t* ctxTypeRaw, FREContext ctx, uint32
              &CAV<&ASClass::GetProtectedNamespace>                                                 },
             {(const uint8_t*)"SetProtectedNamespace", context,
              &CAV<&ASClass::SetProtectedNamespace>                                                 },
-            {(const uint8_t*)"ConvertClassHelper",    context, &CAV<&ASClass::ConvertClassHelper>  }
+            {(const uint8_t*)"ConvertClassHelper",    context, &CAV<&ASClass::ConvertClassHelper>  },
+            {(const uint8_t*)"Disassemble",           context, &CAV<&ASClass::Disassemble>         }
         });
         context->objectData = {
             nextObjectContext->objectData->object, context->editor->partialAssembly.get()};
         nextObjectContext = std::nullopt;
         *functions        = context->functions.get();
-        *numFunctions     = 23;
+        *numFunctions     = 24;
     }
     else if (ctxType == "Script"sv)
     {
@@ -106,12 +124,13 @@ void ContextInitializer(void*, const uint8_t* ctxTypeRaw, FREContext ctx, uint32
             {(const uint8_t*)"GetInitializer", context, &CAV<&ASScript::GetInitializer>},
             {(const uint8_t*)"SetInitializer", context, &CAV<&ASScript::SetInitializer>},
             {(const uint8_t*)"CreateClass",    context, &CAV<&ASScript::CreateClass>   },
+            {(const uint8_t*)"Disassemble",    context, &CAV<&ASScript::Disassemble>   },
         });
         context->objectData = {
             nextObjectContext->objectData->object, context->editor->partialAssembly.get()};
         nextObjectContext = std::nullopt;
         *functions        = context->functions.get();
-        *numFunctions     = 7;
+        *numFunctions     = 8;
     }
     FRESetContextNativeData(ctx, context);
 }
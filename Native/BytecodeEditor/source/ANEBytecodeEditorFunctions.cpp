@@ -189,6 +189,104 @@ FREObject Cleanup(FREContext, void* funcData, uint32_t argc, FREObject[])
     return nullptr;
 }
 
+FREObject SetMinimizePoolSizes(FREContext, void* funcData, uint32_t argc, FREObject argv[])
+{
+    CHECK_ARGC(1);
+
+    GET_EDITOR();
+
+    try
+    {
+        editor.minimizePoolSizes = CHECK_OBJECT<FRE_TYPE_BOOLEAN>(argv[0]);
+    }
+    catch (FREObject o)
+    {
+        return o;
+    }
+    catch (std::nullptr_t)
+    {
+        FAIL("nullptr caught");
+    }
+    catch (std::exception& e)
+    {
+        FAIL(e.what());
+    }
+    catch (...)
+    {
+        FAIL("Some weird thing caught");
+    }
+
+    return nullptr;
+}
+
+FREObject SetDisassemblyCache(FREContext, void* funcData, uint32_t argc, FREObject argv[])
+{
+    CHECK_ARGC(1);
+
+    GET_EDITOR();
+
+    try
+    {
+        // null turns the cache off
+        editor.disassemblyCacheDirectory = CHECK_STRING<true>(argv[0]).value_or("");
+    }
+    catch (FREObject o)
+    {
+        return o;
+    }
+    catch (std::nullptr_t)
+    {
+        FAIL("nullptr caught");
+    }
+    catch (std::exception& e)
+    {
+        FAIL(e.what());
+    }
+    catch (...)
+    {
+        FAIL("Some weird thing caught");
+    }
+
+    return nullptr;
+}
+
+FREObject SetParseCache(FREContext, void* funcData, uint32_t argc, FREObject argv[])
+{
+    CHECK_ARGC(1);
+
+    GET_EDITOR();
+
+    try
+    {
+        if (!CHECK_OBJECT<FRE_TYPE_BOOLEAN>(argv[0]))
+        {
+            editor.parseCache = nullptr;
+        }
+        else if (!editor.parseCache)
+        {
+            editor.parseCache = std::make_shared<Assembler::ParseCache>();
+        }
+    }
+    catch (FREObject o)
+    {
+        return o;
+    }
+    catch (std::nullptr_t)
+    {
+        FAIL("nullptr caught");
+    }
+    catch (std::exception& e)
+    {
+        FAIL(e.what());
+    }
+    catch (...)
+    {
+        FAIL("Some weird thing caught");
+    }
+
+    return nullptr;
+}
+
 FREObject GetClass(FREContext, void* funcData, uint32_t argc, FREObject argv[])
 {
     CHECK_ARGC(1);
@@ -371,3 +469,105 @@ FREObject GetROScript(FREContext, void* funcData, uint32_t argc, FREObject argv[
 
     return ret;
 }
+
+FREObject FindMultinameUsages(FREContext, void* funcData, uint32_t argc, FREObject argv[])
+{
+    CHECK_ARGC(1);
+
+    GET_EDITOR();
+
+    if (!editor.partialAssembly)
+    {
+        FAIL("No partial assembly found");
+    }
+
+    try
+    {
+        return editor.ConvertUsages(
+            editor.partialAssembly->xrefs.usagesOf(editor.ConvertMultiname(argv[0])));
+    }
+    catch (FREObject o)
+    {
+        return o;
+    }
+    catch (std::nullptr_t)
+    {
+        FAIL("nullptr caught");
+    }
+    catch (std::exception& e)
+    {
+        FAIL(e.what());
+    }
+    catch (...)
+    {
+        FAIL("Some weird thing caught");
+    }
+}
+
+FREObject FindStringUsages(FREContext, void* funcData, uint32_t argc, FREObject argv[])
+{
+    CHECK_ARGC(1);
+
+    GET_EDITOR();
+
+    if (!editor.partialAssembly)
+    {
+        FAIL("No partial assembly found");
+    }
+
+    try
+    {
+        return editor.ConvertUsages(
+            editor.partialAssembly->xrefs.usagesOf(CHECK_STRING<false>(argv[0])));
+    }
+    catch (FREObject o)
+    {
+        return o;
+    }
+    catch (std::nullptr_t)
+    {
+        FAIL("nullptr caught");
+    }
+    catch (std::exception& e)
+    {
+        FAIL(e.what());
+    }
+    catch (...)
+    {
+        FAIL("Some weird thing caught");
+    }
+}
+
+FREObject FindClassUsages(FREContext, void* funcData, uint32_t argc, FREObject argv[])
+{
+    CHECK_ARGC(1);
+
+    GET_EDITOR();
+
+    if (!editor.partialAssembly)
+    {
+        FAIL("No partial assembly found");
+    }
+
+    try
+    {
+        return editor.ConvertUsages(
+            editor.partialAssembly->xrefs.usagesOf(editor.ConvertClass(argv[0]).get()));
+    }
+    catch (FREObject o)
+    {
+        return o;
+    }
+    catch (std::nullptr_t)
+    {
+        FAIL("nullptr caught");
+    }
+    catch (std::exception& e)
+    {
+        FAIL(e.what());
+    }
+    catch (...)
+    {
+        FAIL("Some weird thing caught");
+    }
+}
@@ -1,5 +1,7 @@
 #include "ASASM/ASProgram.hpp"
 #include "ASASM/AStoABC.hpp"
+#include "utils/Parallel.hpp"
+#include <atomic>
 #include <queue>
 #include <unordered_set>
 
@@ -51,8 +53,9 @@ ASASM::ASProgram ASASM::ASProgram::fromABC(const SWFABC::ABCFile& abc)
     std::vector<std::shared_ptr<Class>> classes;
     std::vector<std::shared_ptr<Method>> methods;
 
-    std::vector<bool> methodAdded;
-    std::vector<bool> classAdded;
+    // Atomic because method bodies are converted concurrently and their traits mark these too
+    std::vector<std::atomic_bool> methodAdded(abc.methods.size());
+    std::vector<std::atomic_bool> classAdded(abc.instances.size());
 
     // Whether or not the class has already been converted
     std::vector<bool> classSet;
@@ -67,12 +70,12 @@ ASASM::ASProgram ASASM::ASProgram::fromABC(const SWFABC::ABCFile& abc)
 
     auto getMethod = [&](uint32_t index) -> std::shared_ptr<Method>&
     {
-        methodAdded[index] = true;
+        methodAdded[index].store(true, std::memory_order_relaxed);
         return methods[index];
     };
     const auto getClass = [&](uint32_t index) -> std::shared_ptr<Class>&
     {
-        classAdded[index] = true;
+        classAdded[index].store(true, std::memory_order_relaxed);
         return classes[index];
     };
 
@@ -383,7 +386,7 @@ ASASM::ASProgram ASASM::ASProgram::fromABC(const SWFABC::ABCFile& abc)
         {
             ret.instructions.emplace_back(convertInstruction(instruction));
         }
-        ret.exceptions.reserve(ret.exceptions.size());
+        ret.exceptions.reserve(body.exceptions.size());
         for (const auto& exception : body.exceptions)
         {
             ret.exceptions.emplace_back(exception.from, exception.to, exception.target,
@@ -407,8 +410,6 @@ ASASM::ASProgram ASASM::ASProgram::fromABC(const SWFABC::ABCFile& abc)
     asp.scripts.reserve(abc.scripts.size());
 
     classSet.resize(abc.classes.size(), false);
-    classAdded.resize(abc.instances.size(), false);
-    methodAdded.resize(abc.methods.size(), false);
 
     namespaces.emplace_back();
     for (size_t i = 1; i < abc.namespaces.size(); i++)
@@ -457,14 +458,20 @@ ASASM::ASProgram ASASM::ASProgram::fromABC(const SWFABC::ABCFile& abc)
         asp.scripts.emplace_back(convertScript(abc.scripts[i]));
     }
 
+    // Every pool and every method and class shell exists by now, so bodies only read shared state
+    // and can be converted independently. Results are stored by body index and attached in order
+    // afterwards, so a method with multiple bodies still ends up with the last one.
+    std::vector<std::optional<MethodBody>> bodies(abc.bodies.size());
+    Parallel::forEach(abc.bodies.size(), [&](size_t i) { bodies[i] = convertBody(abc.bodies[i]); });
+
     for (size_t i = 0; i < abc.bodies.size(); i++)
     {
-        methods[abc.bodies[i].method]->vbody = convertBody(abc.bodies[i]);
+        methods[abc.bodies[i].method]->vbody = std::move(bodies[i]);
     }
 
     for (size_t i = 0; i < classAdded.size(); i++)
     {
-        if (!classAdded[i])
+        if (!classAdded[i].load(std::memory_order_relaxed))
         {
             asp.orphanClasses.emplace_back(classes[i]);
         }
@@ -472,7 +479,7 @@ ASASM::ASProgram ASASM::ASProgram::fromABC(const SWFABC::ABCFile& abc)
 
     for (size_t i = 0; i < methodAdded.size(); i++)
     {
-        if (!methodAdded[i])
+        if (!methodAdded[i].load(std::memory_order_relaxed))
         {
             asp.orphanMethods.emplace_back(methods[i]);
         }
@@ -481,7 +488,9 @@ ASASM::ASProgram ASASM::ASProgram::fromABC(const SWFABC::ABCFile& abc)
     return asp;
 }
 
-SWFABC::ABCFile ASASM::ASProgram::toABC()
+SWFABC::ABCFile ASASM::ASProgram::toABC(bool minimizePoolSizes)
 {
-    return AStoABC(*this).abc;
+    AStoABC lowering(*this);
+    lowering.lower(minimizePoolSizes);
+    return std::move(lowering.abc);
 }
@@ -17,6 +17,20 @@ using namespace std::string_view_literals;
 
 namespace
 {
+    // Keeps the editor's indices in sync after a change to a class or script
+    template <typename T>
+    void updateIndices(BytecodeEditor& editor, const std::shared_ptr<T>& object)
+    {
+        // Script-level traits are what the symbol index covers
+        if constexpr (std::is_same_v<T, ASASM::Script>)
+        {
+            editor.partialAssembly->symbols.update(object);
+        }
+        editor.partialAssembly->xrefs.invalidate(object.get());
+        editor.partialAssembly->lowering.invalidate(object.get());
+        editor.partialAssembly->disassembler = nullptr;
+    }
+
     template <typename T, auto accessor>
     FREObject GetTrait(FREContext, void* funcData, uint32_t argc, FREObject argv[])
     {
@@ -31,46 +45,41 @@ namespace
 
             bool favorSetter = CHECK_OBJECT<FRE_TYPE_BOOLEAN>(argv[1]);
 
-            SmallTrivialVector<const ASASM::Trait*, 2> found;
+            const auto& traits = std::invoke(accessor, clazz).traits;
+
+            auto found = traits.find(name);
 
-            for (const auto& trait : std::invoke(accessor, clazz).traits)
+            if (found.size() > 2)
             {
-                if (trait.name == name)
-                {
-                    if (!found.emplace_back(&trait))
-                    {
-                        FAIL("More than two traits matched this multiname. This should never "
-                             "happen!");
-                    }
-                }
+                FAIL("More than two traits matched this multiname. This should never happen!");
             }
 
             if (found.size() == 1)
             {
-                return editor.ConvertTrait(*found[0]);
+                return editor.ConvertTrait(traits[found[0]]);
             }
             else if (found.size() == 2)
             {
-                if (favorSetter && found[0]->kind == TraitKind::Getter)
+                if (favorSetter && traits[found[0]].kind == TraitKind::Getter)
                 {
                     if (favorSetter)
                     {
-                        return editor.ConvertTrait(*found[1]);
+                        return editor.ConvertTrait(traits[found[1]]);
                     }
                     else
                     {
-                        return editor.ConvertTrait(*found[0]);
+                        return editor.ConvertTrait(traits[found[0]]);
                     }
                 }
                 else
                 {
                     if (favorSetter)
                     {
-                        return editor.ConvertTrait(*found[0]);
+                        return editor.ConvertTrait(traits[found[0]]);
                     }
                     else
                     {
-                        return editor.ConvertTrait(*found[1]);
+                        return editor.ConvertTrait(traits[found[1]]);
                     }
                 }
             }
@@ -150,20 +159,13 @@ namespace
         {
             ASASM::Trait value = editor.ConvertTrait(argv[0]);
 
-            SmallTrivialVector<size_t, 2> found{};
-
             auto& traits = std::invoke(accessor, clazz).traits;
 
-            for (size_t i = 0; i < traits.size(); i++)
+            auto found = traits.find(value.name);
+
+            if (found.size() > 2)
             {
-                if (traits[i].name == value.name)
-                {
-                    if (!found.emplace_back(i))
-                    {
-                        FAIL("More than two traits matched this multiname. This should never "
-                             "happen!");
-                    }
-                }
+                FAIL("More than two traits matched this multiname. This should never happen!");
             }
 
             if (found.size() > 0)
@@ -174,30 +176,29 @@ namespace
                     {
                         if (traits[found[0]].kind == TraitKind::Getter)
                         {
-                            traits[found[0]] = std::move(value);
+                            traits.replace(found[0], std::move(value));
                         }
                         else
                         {
-                            traits[found[1]] = std::move(value);
+                            traits.replace(found[1], std::move(value));
                         }
                     }
                     else if (value.kind == TraitKind::Setter)
                     {
                         if (traits[found[0]].kind == TraitKind::Setter)
                         {
-                            traits[found[0]] = std::move(value);
+                            traits.replace(found[0], std::move(value));
                         }
                         else
                         {
-                            traits[found[1]] = std::move(value);
+                            traits.replace(found[1], std::move(value));
                         }
                     }
                     else
                     {
-                        traits.erase(
-                            traits.begin() +
-                            found[1]); // Erase found[1] because it's the closest to the back
-                        traits[found[0]] = std::move(value); // And replace found[0]
+                        // Erase found[1] because it's the closest to the back
+                        traits.erase(found[1]);
+                        traits.replace(found[0], std::move(value)); // And replace found[0]
                     }
                 }
                 else
@@ -207,7 +208,7 @@ namespace
                         (value.kind == TraitKind::Setter || value.kind == TraitKind::Getter) &&
                         kind == value.kind)
                     {
-                        traits[found[0]] = std::move(value);
+                        traits.replace(found[0], std::move(value));
                     }
                     else if ((kind == TraitKind::Getter || kind == TraitKind::Setter) &&
                              (value.kind == TraitKind::Setter || value.kind == TraitKind::Getter) &&
@@ -217,7 +218,7 @@ namespace
                     }
                     else
                     {
-                        traits[found[0]] = std::move(value);
+                        traits.replace(found[0], std::move(value));
                     }
                 }
             }
@@ -225,6 +226,8 @@ namespace
             {
                 traits.emplace_back(std::move(value));
             }
+
+            updateIndices<T>(editor, clazz);
         }
         catch (FREObject o)
         {
@@ -262,24 +265,17 @@ namespace
 
             auto& traits = std::invoke(accessor, clazz).traits;
 
-            SmallTrivialVector<size_t, 2> found;
+            auto found = traits.find(name);
 
-            for (size_t i = 0; i < traits.size(); i++)
+            if (found.size() > 2)
             {
-                const auto& trait = traits[i];
-                if (trait.name == name)
-                {
-                    if (!found.emplace_back(i))
-                    {
-                        FAIL("More than two traits matched this multiname. This should never "
-                             "happen!");
-                    }
-                }
+                FAIL("More than two traits matched this multiname. This should never happen!");
             }
 
             if (found.size() == 1)
             {
-                traits.erase(traits.begin() + found[0]);
+                traits.erase(found[0]);
+                updateIndices<T>(editor, clazz);
                 SUCCEED_VOID();
             }
             else if (found.size() == 2)
@@ -288,24 +284,25 @@ namespace
                 {
                     if (favorSetter)
                     {
-                        traits.erase(traits.begin() + found[1]);
+                        traits.erase(found[1]);
                     }
                     else
                     {
-                        traits.erase(traits.begin() + found[0]);
+                        traits.erase(found[0]);
                     }
                 }
                 else
                 {
                     if (favorSetter)
                     {
-                        traits.erase(traits.begin() + found[0]);
+                        traits.erase(found[0]);
                     }
                     else
                     {
-                        traits.erase(traits.begin() + found[1]);
+                        traits.erase(found[1]);
                     }
                 }
+                updateIndices<T>(editor, clazz);
                 SUCCEED_VOID();
             }
 
@@ -370,6 +367,8 @@ namespace
         try
         {
             std::invoke(accessor, clazz) = editor.ConvertMethod(argv[0]);
+
+            updateIndices<T>(editor, clazz);
         }
         catch (FREObject o)
         {
@@ -390,6 +389,45 @@ namespace
 
         SUCCEED_VOID();
     }
+
+    // Disassembles just the object, into the files a full disassembly would give it
+    template <typename T>
+    FREObject DisassembleObject(FREContext, void* funcData, uint32_t argc, FREObject[])
+    {
+        CHECK_ARGC(0);
+
+        GET_TYPE(T);
+        GET_EDITOR();
+
+        try
+        {
+            auto& disassembler = editor.partialAssembly->disassembler;
+            if (!disassembler)
+            {
+                disassembler = std::make_unique<Disassembler>(editor.partialAssembly->program);
+            }
+
+            MapSink sink;
+            disassembler->disassemble(*clazz, sink);
+            return editor.ConvertFiles(sink.files);
+        }
+        catch (FREObject o)
+        {
+            return o;
+        }
+        catch (std::nullptr_t)
+        {
+            FAIL("nullptr caught");
+        }
+        catch (std::exception& e)
+        {
+            FAIL(std::string("Exception: ") + e.what());
+        }
+        catch (...)
+        {
+            FAIL("Some weird thing caught");
+        }
+    }
 }
 
 namespace ASClass
@@ -539,6 +577,8 @@ namespace ASClass
             }
 
             clazz->instance.interfaces = newMultinames;
+
+            updateIndices<ASASM::Class>(editor, clazz);
         }
         catch (FREObject o)
         {
@@ -599,6 +639,8 @@ namespace ASClass
         try
         {
             clazz->instance.superName = editor.ConvertMultiname(argv[0]);
+
+            updateIndices<ASASM::Class>(editor, clazz);
         }
         catch (FREObject o)
         {
@@ -659,6 +701,8 @@ namespace ASClass
         try
         {
             clazz->instance.name = editor.ConvertMultiname(argv[0]);
+
+            updateIndices<ASASM::Class>(editor, clazz);
         }
         catch (FREObject o)
         {
@@ -730,6 +774,7 @@ namespace ASClass
         CHECK_ARGC(1);
 
         GET_TYPE(ASASM::Class);
+        GET_EDITOR();
 
         try
         {
@@ -745,6 +790,8 @@ namespace ASClass
             }
 
             clazz->instance.flags = flags;
+
+            updateIndices<ASASM::Class>(editor, clazz);
         }
         catch (FREObject o)
         {
@@ -805,6 +852,8 @@ namespace ASClass
         try
         {
             clazz->instance.protectedNs = editor.ConvertNamespace(argv[0]);
+
+            updateIndices<ASASM::Class>(editor, clazz);
         }
         catch (FREObject o)
         {
@@ -838,6 +887,11 @@ namespace ASClass
 
         return nullptr;
     }
+
+    FREObject Disassemble(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[])
+    {
+        return ::DisassembleObject<ASASM::Class>(ctx, funcData, argc, argv);
+    }
 }
 
 namespace ASScript
@@ -893,13 +947,17 @@ namespace ASScript
 
         try
         {
-            ASASM::Trait& newTrait = clazz->traits.emplace_back();
-            newTrait.kind          = TraitKind::Class;
-            newTrait.name          = editor.ConvertMultiname(argv[0]);
-            newTrait.vClass({0,
+            ASASM::Trait added;
+            added.kind = TraitKind::Class;
+            added.name = editor.ConvertMultiname(argv[0]);
+            added.vClass({0,
                 std::shared_ptr<ASASM::Class>(new ASASM::Class(editor.ConvertMethod(argv[1]), {},
                     ASASM::Instance{
-                        .name = newTrait.name, .iinit = editor.ConvertMethod(argv[2])}))});
+                        .name = added.name, .iinit = editor.ConvertMethod(argv[2])}))});
+
+            const ASASM::Trait& newTrait = clazz->traits.emplace_back(std::move(added));
+
+            updateIndices<ASASM::Script>(editor, clazz);
 
             return editor.ConvertClass(newTrait.vClass().vclass);
         }
@@ -920,4 +978,9 @@ namespace ASScript
             FAIL("Some weird thing caught");
         }
     }
+
+    FREObject Disassemble(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[])
+    {
+        return ::DisassembleObject<ASASM::Script>(ctx, funcData, argc, argv);
+    }
 }
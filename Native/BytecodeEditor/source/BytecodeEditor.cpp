@@ -4,6 +4,12 @@
 #include "Assembler.hpp"
 #include "Disassembler.hpp"
 #include "SWF/SWFFile.hpp"
+#include "utils/DisassemblySink.hpp"
+#include "utils/MethodBodyCache.hpp"
+#include "utils/ProjectArchive.hpp"
+
+#include <filesystem>
+#include <optional>
 
 #define FAIL_ASYNC(x)                                                                              \
     m_taskResult = x;                                                                              \
@@ -16,6 +22,56 @@
 #define SUCCEED_ASYNC_WITHMESSAGE(message)                                                         \
     FREDispatchStatusEventAsync(ctx, (const uint8_t*)"Task complete", (const uint8_t*)(message))
 
+namespace
+{
+    // Paths from AIR are UTF-8
+    std::filesystem::path utf8Path(const std::string& path)
+    {
+        return std::filesystem::path(std::u8string_view((const char8_t*)path.data(), path.size()));
+    }
+
+    std::unique_ptr<DisassemblySink> sinkForPath(const std::string& path)
+    {
+        const std::filesystem::path fsPath = utf8Path(path);
+        if (fsPath.extension() == ".tar")
+        {
+            return std::make_unique<TarSink>(fsPath);
+        }
+        if (fsPath.extension() == ProjectArchiveFormat::EXTENSION)
+        {
+            return std::make_unique<ArchiveSink>(fsPath);
+        }
+        return std::make_unique<DirectorySink>(fsPath);
+    }
+
+    // Goes through the method body cache in cacheDirectory, unless it's empty. The cache is only
+    // saved once the whole disassembly has succeeded.
+    void disassembleInto(
+        const ASASM::ASProgram& program, DisassemblySink& sink, const std::string& cacheDirectory)
+    {
+        std::optional<MethodBodyCache> cache;
+        if (!cacheDirectory.empty())
+        {
+            cache.emplace(utf8Path(cacheDirectory));
+        }
+
+        Disassembler::Disassembler(program, cache ? &*cache : nullptr).disassemble(sink);
+
+        if (cache)
+        {
+            cache->save();
+        }
+    }
+
+    std::unordered_map<std::string, std::string> disassembleFiles(
+        const ASASM::ASProgram& program, const std::string& cacheDirectory)
+    {
+        MapSink sink;
+        disassembleInto(program, sink, cacheDirectory);
+        return std::move(sink.files);
+    }
+}
+
 FREObject BytecodeEditor::disassemble(std::span<const uint8_t> swf)
 {
     if (runningTask.joinable())
@@ -25,21 +81,35 @@ FREObject BytecodeEditor::disassemble(std::span<const uint8_t> swf)
 
     try
     {
-        auto strings = Disassembler::Disassembler(
-            ASASM::ASProgram::fromABC(SWF::SWFFile::extractABCFrom(swf).value()))
-                           .disassemble();
-
-        FREObject ret;
-        DO_OR_FAIL(
-            "Failed to create return object", ANENewObject("Object", 0, nullptr, &ret, nullptr));
+        return ConvertFiles(disassembleFiles(
+            ASASM::ASProgram::fromABC(SWF::SWFFile::extractABCFrom(swf).value()),
+            disassemblyCacheDirectory));
+    }
+    catch (FREObject o)
+    {
+        return o;
+    }
+    catch (std::bad_optional_access&)
+    {
+        FAIL("SWF does not appear to have any ABC tags");
+    }
+    catch (std::exception& e)
+    {
+        FAIL(std::string("Exception during disassembly: ") + e.what());
+    }
+}
 
-        for (const auto& file : strings)
-        {
-            DO_OR_FAIL("Failed to set data",
-                ANESetObjectProperty(ret, file.first.c_str(), FREString(file.second), nullptr));
-        }
+FREObject BytecodeEditor::disassembleToPath(std::span<const uint8_t> swf, std::string&& path)
+{
+    if (runningTask.joinable())
+    {
+        FAIL("Already running a task");
+    }
 
-        return ret;
+    try
+    {
+        disassembleInto(ASASM::ASProgram::fromABC(SWF::SWFFile::extractABCFrom(swf).value()),
+            *sinkForPath(path), disassemblyCacheDirectory);
     }
     catch (std::bad_optional_access&)
     {
@@ -49,6 +119,10 @@ FREObject BytecodeEditor::disassemble(std::span<const uint8_t> swf)
     {
         FAIL(std::string("Exception during disassembly: ") + e.what());
     }
+
+    FREObject ret;
+    DO_OR_FAIL("Failed to create success boolean", FRENewObjectFromBool(1, &ret));
+    return ret;
 }
 
 FREObject BytecodeEditor::assemble(
@@ -62,32 +136,16 @@ FREObject BytecodeEditor::assemble(
     try
     {
         std::vector<uint8_t> data = std::move(
-            SWFABC::ABCWriter(Assembler::assemble(strings, includeDebugInstructions).toABC())
+            SWFABC::ABCWriter(
+                Assembler::assemble(strings, includeDebugInstructions, parseCache.get())
+                    .toABC(minimizePoolSizes))
                 .data());
 
-        auto tagInfo = SWF::SWFFile::buildTagHeaderForABCData(data);
-
-        FREObject lengthObj;
-        DO_OR_FAIL("Failed to create length object",
-            FRENewObjectFromUint32(data.size() + tagInfo.size(), &lengthObj));
-
-        FREObject bytearrayObj;
-        DO_OR_FAIL("Failed to create returned bytearray",
-            ANENewObject("flash.utils.ByteArray", 0, nullptr, &bytearrayObj, nullptr));
-
-        DO_OR_FAIL("Failed to set returned bytearray length to required size",
-            ANESetObjectProperty(bytearrayObj, "length", lengthObj, nullptr));
-
-        FREByteArray ba;
-        DO_OR_FAIL("Failed to acquire bytearray", FREAcquireByteArray(bytearrayObj, &ba));
-
-        std::copy(tagInfo.begin(), tagInfo.end(), ba.bytes);
-
-        std::copy(data.begin(), data.end(), ba.bytes + tagInfo.size());
-
-        DO_OR_FAIL("Failed to release bytearray", FREReleaseByteArray(bytearrayObj));
-
-        return bytearrayObj;
+        return ConvertABCTag(data);
+    }
+    catch (FREObject o)
+    {
+        return o;
     }
     catch (const std::exception& e)
     {
@@ -105,12 +163,54 @@ FREObject BytecodeEditor::disassembleAsync(std::span<const uint8_t> data)
     try
     {
         runningTask = std::jthread(
-            [this, abc = SWF::SWFFile::extractABCFrom(data)]
+            [this, abc = SWF::SWFFile::extractABCFrom(data),
+                cacheDirectory = disassemblyCacheDirectory]
             {
                 try
                 {
-                    SUCCEED_ASYNC(Disassembler::Disassembler(ASASM::ASProgram::fromABC(abc.value()))
-                                      .disassemble());
+                    SUCCEED_ASYNC(
+                        disassembleFiles(ASASM::ASProgram::fromABC(abc.value()), cacheDirectory));
+                }
+                catch (std::bad_optional_access&)
+                {
+                    FAIL_ASYNC("SWF does not appear to have any ABC tags");
+                }
+                catch (const std::exception& e)
+                {
+                    FAIL_ASYNC(std::string("Exception during disassembly: ") + e.what());
+                }
+            });
+    }
+    catch (const std::exception& e)
+    {
+        FAIL(std::string("Exception during disassembly: ") + e.what());
+    }
+
+    FREObject ret;
+    DO_OR_FAIL("Failed to create success boolean", FRENewObjectFromBool(1, &ret));
+    return ret;
+}
+
+FREObject BytecodeEditor::disassembleToPathAsync(
+    std::span<const uint8_t> data, std::string&& path)
+{
+    if (runningTask.joinable())
+    {
+        FAIL("Already running a task");
+    }
+
+    try
+    {
+        runningTask = std::jthread(
+            [this, abc = SWF::SWFFile::extractABCFrom(data), path = std::move(path),
+                cacheDirectory = disassemblyCacheDirectory]
+            {
+                try
+                {
+                    disassembleInto(ASASM::ASProgram::fromABC(abc.value()), *sinkForPath(path),
+                        cacheDirectory);
+
+                    SUCCEED_ASYNC_WITHMESSAGE("DisassemblyWritten");
                 }
                 catch (std::bad_optional_access&)
                 {
@@ -141,13 +241,14 @@ FREObject BytecodeEditor::assembleAsync(
     }
 
     runningTask = std::jthread(
-        [this, strings = std::move(strings), includeDebugInstructions]
+        [this, strings = std::move(strings), includeDebugInstructions,
+            minimizePoolSizes = minimizePoolSizes, cache = parseCache]
         {
             try
             {
-                SUCCEED_ASYNC(std::move(SWFABC::ABCWriter(
-                    Assembler::assemble(strings, includeDebugInstructions).toABC())
-                                            .data()));
+                auto abc = Assembler::assemble(strings, includeDebugInstructions, cache.get())
+                               .toABC(minimizePoolSizes);
+                SUCCEED_ASYNC(std::move(SWFABC::ABCWriter(abc).data()));
             }
             catch (const std::exception& e)
             {
@@ -160,6 +261,70 @@ FREObject BytecodeEditor::assembleAsync(
     return ret;
 }
 
+FREObject BytecodeEditor::assembleFromPath(std::string&& path, bool includeDebugInstructions)
+{
+    if (runningTask.joinable())
+    {
+        FAIL("Already running a task");
+    }
+
+    try
+    {
+        const ProjectArchive archive(utf8Path(path));
+        std::vector<uint8_t> data = std::move(
+            SWFABC::ABCWriter(
+                Assembler::assemble(archive, includeDebugInstructions, parseCache.get())
+                    .toABC(minimizePoolSizes))
+                .data());
+
+        return ConvertABCTag(data);
+    }
+    catch (FREObject o)
+    {
+        return o;
+    }
+    catch (const std::exception& e)
+    {
+        FAIL(std::string("Exception during assembly: ") + e.what());
+    }
+}
+
+FREObject BytecodeEditor::assembleFromPathAsync(std::string&& path, bool includeDebugInstructions)
+{
+    if (runningTask.joinable())
+    {
+        FAIL("Already running a task");
+    }
+
+    try
+    {
+        runningTask = std::jthread(
+            [this, path = std::move(path), includeDebugInstructions,
+                minimizePoolSizes = minimizePoolSizes, cache = parseCache]
+            {
+                try
+                {
+                    const ProjectArchive archive(utf8Path(path));
+                    auto abc = Assembler::assemble(archive, includeDebugInstructions, cache.get())
+                                   .toABC(minimizePoolSizes);
+                    SUCCEED_ASYNC(std::move(SWFABC::ABCWriter(abc).data()));
+                }
+                catch (const std::exception& e)
+                {
+                    FAIL_ASYNC(std::string("Exception during assembly: ") + e.what());
+                }
+            });
+    }
+    catch (const std::exception& e)
+    {
+        FAIL(std::string("Exception during assembly: ") + e.what());
+    }
+
+    FREObject ret;
+    DO_OR_FAIL("Failed to create success boolean", FRENewObjectFromBool(1, &ret));
+    return ret;
+}
+
 FREObject BytecodeEditor::partialAssemble(
     std::unordered_map<std::string, std::string>&& strings, bool includeDebugInstructions)
 {
@@ -170,7 +335,7 @@ FREObject BytecodeEditor::partialAssemble(
 
     try
     {
-        auto assembled = Assembler::assemble(strings, includeDebugInstructions);
+        auto assembled = Assembler::assemble(strings, includeDebugInstructions, parseCache.get());
         RefBuilder rb(assembled);
         rb.run();
         this->partialAssembly =
@@ -195,11 +360,12 @@ FREObject BytecodeEditor::partialAssembleAsync(
     }
 
     runningTask = std::jthread(
-        [this, strings = std::move(strings), includeDebugInstructions]
+        [this, strings = std::move(strings), includeDebugInstructions, cache = parseCache]
         {
             try
             {
-                auto assembled = Assembler::assemble(strings, includeDebugInstructions);
+                auto assembled =
+                    Assembler::assemble(strings, includeDebugInstructions, cache.get());
                 RefBuilder rb(assembled);
                 rb.run();
                 this->partialAssembly =
@@ -232,9 +398,8 @@ FREObject BytecodeEditor::finishAssemble()
 
     try
     {
-        std::vector<uint8_t> data =
-            std::move(SWFABC::ABCWriter(partialAssembly->program.toABC()).data());
-        partialAssembly = nullptr;
+        std::vector<uint8_t> data = std::move(
+            SWFABC::ABCWriter(partialAssembly->lowering.lower(minimizePoolSizes)).data());
 
         auto tagInfo = SWF::SWFFile::buildTagHeaderForABCData(data);
 
@@ -273,7 +438,7 @@ FREObject BytecodeEditor::finishAssembleAsync()
     }
 
     runningTask = std::jthread(
-        [this]
+        [this, minimizePoolSizes = minimizePoolSizes]
         {
             if (!partialAssembly)
             {
@@ -281,10 +446,8 @@ FREObject BytecodeEditor::finishAssembleAsync()
             }
             try
             {
-                std::vector<uint8_t> data =
-                    std::move(SWFABC::ABCWriter(partialAssembly->program.toABC()).data());
-
-                partialAssembly = nullptr;
+                std::vector<uint8_t> data = std::move(
+                    SWFABC::ABCWriter(partialAssembly->lowering.lower(minimizePoolSizes)).data());
 
                 SUCCEED_ASYNC(std::move(data));
             }
@@ -339,24 +502,17 @@ FREObject BytecodeEditor::listClasses() const
         FAIL("No partial assembly found");
     }
 
+    const auto& names = partialAssembly->symbols.classNames();
+
     FREObject ret;
     DO_OR_FAIL("Couldn't create class name vector",
         ANENewObject("Vector.<com.cff.anebe.ir.ASMultiname>", 0, nullptr, &ret, nullptr));
-    DO_OR_FAIL("Couldn't set class name vector size to nominal",
-        FRESetArrayLength(ret, partialAssembly->program.scripts.size()));
-    size_t index = 0;
-    for (const auto& script : partialAssembly->program.scripts)
+    DO_OR_FAIL("Couldn't set class name vector size", FRESetArrayLength(ret, names.size()));
+    for (size_t i = 0; i < names.size(); i++)
     {
-        for (const auto& trait : script->traits)
-        {
-            if (trait.kind == TraitKind::Class)
-            {
-                DO_OR_FAIL("Couldn't set class name vector entry",
-                    FRESetArrayElementAt(ret, index++, ConvertMultiname(trait.name)));
-            }
-        }
+        DO_OR_FAIL("Couldn't set class name vector entry",
+            FRESetArrayElementAt(ret, i, ConvertMultiname(names[i])));
     }
-    DO_OR_FAIL("Couldn't shrink class name vector size to actual", FRESetArrayLength(ret, index));
 
     return ret;
 }
@@ -372,21 +528,17 @@ FREObject BytecodeEditor::listScripts() const
         FAIL("No partial assembly found");
     }
 
+    const auto& names = partialAssembly->symbols.scriptNames();
+
     FREObject ret;
     DO_OR_FAIL("Couldn't create script name vector",
         ANENewObject("Vector.<com.cff.anebe.ir.ASMultiname>", 0, nullptr, &ret, nullptr));
-    DO_OR_FAIL("Couldn't set script name vector size to nominal",
-        FRESetArrayLength(ret, partialAssembly->program.scripts.size()));
-    size_t index = 0;
-    for (const auto& script : partialAssembly->program.scripts)
+    DO_OR_FAIL("Couldn't set script name vector size", FRESetArrayLength(ret, names.size()));
+    for (size_t i = 0; i < names.size(); i++)
     {
-        if (script->traits.size() > 0)
-        {
-            DO_OR_FAIL("Couldn't set script name vector entry",
-                FRESetArrayElementAt(ret, index++, ConvertMultiname(script->traits[0].name)));
-        }
+        DO_OR_FAIL("Couldn't set script name vector entry",
+            FRESetArrayElementAt(ret, i, ConvertMultiname(names[i])));
     }
-    DO_OR_FAIL("Couldn't shrink script name vector size to actual", FRESetArrayLength(ret, index));
 
     return ret;
 }
@@ -398,18 +550,7 @@ std::shared_ptr<ASASM::Class> BytecodeEditor::getClass(const ASASM::Multiname& c
         return nullptr;
     }
 
-    for (const auto& script : partialAssembly->program.scripts)
-    {
-        for (const auto& trait : script->traits)
-        {
-            if (trait.kind == TraitKind::Class && className == trait.name)
-            {
-                return trait.vClass().vclass;
-            }
-        }
-    }
-
-    return nullptr;
+    return partialAssembly->symbols.getClass(className);
 }
 
 std::shared_ptr<ASASM::Script> BytecodeEditor::getScript(const ASASM::Multiname& traitName) const
@@ -419,24 +560,18 @@ std::shared_ptr<ASASM::Script> BytecodeEditor::getScript(const ASASM::Multiname&
         return nullptr;
     }
 
-    for (const auto& script : partialAssembly->program.scripts)
-    {
-        for (const auto& trait : script->traits)
-        {
-            if (traitName == trait.name)
-            {
-                return script;
-            }
-        }
-    }
-
-    return nullptr;
+    return partialAssembly->symbols.getScript(traitName);
 }
 
 std::shared_ptr<ASASM::Script> BytecodeEditor::createScript(
     const std::shared_ptr<ASASM::Method>& sinit)
 {
-    return partialAssembly->program.scripts.emplace_back(new ASASM::Script{sinit});
+    auto& ret = partialAssembly->program.scripts.emplace_back(new ASASM::Script{sinit});
+    partialAssembly->symbols.update(ret);
+    partialAssembly->xrefs.invalidate(ret.get());
+    partialAssembly->lowering.invalidate(ret.get());
+    partialAssembly->disassembler = nullptr;
+    return ret;
 }
 
 #undef FAIL_RETURN
@@ -466,52 +601,30 @@ FREObject BytecodeEditor::taskResult()
         }
         case 2:
         {
-            const auto& strings = std::get<2>(m_taskResult);
-
-            FREObject ret;
-            DO_OR_FAIL("Failed to create return object",
-                ANENewObject("Object", 0, nullptr, &ret, nullptr));
-
-            for (const auto& file : strings)
+            try
             {
-                DO_OR_FAIL("Failed to set data",
-                    ANESetObjectProperty(ret, file.first.c_str(), FREString(file.second), nullptr));
+                FREObject ret = ConvertFiles(std::get<2>(m_taskResult));
+                m_taskResult  = std::monostate{};
+                return ret;
+            }
+            catch (FREObject o)
+            {
+                m_taskResult = std::monostate{};
+                return o;
             }
-
-            m_taskResult = std::monostate{};
-            return ret;
         }
         case 3:
         {
-            const auto& data = std::get<3>(m_taskResult);
-
             try
             {
-                auto tagInfo = SWF::SWFFile::buildTagHeaderForABCData(data);
-
-                FREObject lengthObj;
-                DO_OR_FAIL("Failed to create length object",
-                    FRENewObjectFromUint32(data.size() + tagInfo.size(), &lengthObj));
-
-                FREObject bytearrayObj;
-                DO_OR_FAIL("Failed to create returned bytearray",
-                    ANENewObject("flash.utils.ByteArray", 0, nullptr, &bytearrayObj, nullptr));
-
-                DO_OR_FAIL("Failed to set returned bytearray length to required size",
-                    ANESetObjectProperty(bytearrayObj, "length", lengthObj, nullptr));
-
-                FREByteArray ba;
-                DO_OR_FAIL("Failed to acquire bytearray", FREAcquireByteArray(bytearrayObj, &ba));
-
-                std::copy(tagInfo.begin(), tagInfo.end(), ba.bytes);
-
-                std::copy(data.begin(), data.end(), ba.bytes + tagInfo.size());
-
-                DO_OR_FAIL("Failed to release bytearray", FREReleaseByteArray(bytearrayObj));
-
+                FREObject ret = ConvertABCTag(std::get<3>(m_taskResult));
+                m_taskResult  = std::monostate{};
+                return ret;
+            }
+            catch (FREObject o)
+            {
                 m_taskResult = std::monostate{};
-
-                return bytearrayObj;
+                return o;
             }
             catch (const std::exception& e)
             {
@@ -1,5 +1,6 @@
 #include "utils/ANEUtils.hpp"
 #include "ANEFunctions.hpp"
+#include "SWF/SWFFile.hpp"
 #include "enums/MethodFlags.hpp"
 
 #undef FAIL_RETURN
@@ -1347,3 +1348,81 @@ ASASM::Value BytecodeEditor::ConvertValue(FREObject o) const
 
     return ret;
 }
+
+FREObject BytecodeEditor::ConvertUsages(const std::vector<CrossReferences::Usage>& usages) const
+{
+    FREObject ret;
+    FREObject exception;
+    DO_OR_FAIL_EXCEPTION("Could not create usage vector", exception,
+        ANENewObject("Vector.<com.cff.anebe.ir.ASUsage>", 0, nullptr, &ret, &exception));
+    DO_OR_FAIL("Could not set usage vector size", FRESetArrayLength(ret, usages.size()));
+
+    // A method usually shows up several times; only convert it once
+    std::unordered_map<const ASASM::Method*, FREObject> methods;
+
+    for (size_t i = 0; i < usages.size(); i++)
+    {
+        auto [method, inserted] = methods.try_emplace(usages[i].method.get(), nullptr);
+        if (inserted)
+        {
+            method->second = ConvertMethod(*usages[i].method);
+        }
+
+        FREObject instruction;
+        DO_OR_FAIL("Could not create usage instruction index",
+            FRENewObjectFromUint32(usages[i].instruction, &instruction));
+
+        FREObject args[] = {method->second, instruction};
+
+        FREObject usage;
+        DO_OR_FAIL_EXCEPTION("Could not create com.cff.anebe.ir.ASUsage", exception,
+            ANENewObject("com.cff.anebe.ir.ASUsage", 2, args, &usage, &exception));
+        DO_OR_FAIL("Could not set usage vector entry", FRESetArrayElementAt(ret, i, usage));
+    }
+
+    return ret;
+}
+
+FREObject BytecodeEditor::ConvertFiles(
+    const std::unordered_map<std::string, std::string>& files) const
+{
+    FREObject ret;
+    FREObject exception;
+    DO_OR_FAIL_EXCEPTION("Could not create file object", exception,
+        ANENewObject("Object", 0, nullptr, &ret, &exception));
+
+    for (const auto& file : files)
+    {
+        DO_OR_FAIL_EXCEPTION("Could not set file data", exception,
+            ANESetObjectProperty(ret, file.first.c_str(), FREString(file.second), &exception));
+    }
+
+    return ret;
+}
+
+FREObject BytecodeEditor::ConvertABCTag(const std::vector<uint8_t>& abc) const
+{
+    auto tagInfo = SWF::SWFFile::buildTagHeaderForABCData(abc);
+
+    FREObject lengthObj;
+    DO_OR_FAIL("Failed to create length object",
+        FRENewObjectFromUint32(abc.size() + tagInfo.size(), &lengthObj));
+
+    FREObject bytearrayObj;
+    DO_OR_FAIL("Failed to create returned bytearray",
+        ANENewObject("flash.utils.ByteArray", 0, nullptr, &bytearrayObj, nullptr));
+
+    DO_OR_FAIL("Failed to set returned bytearray length to required size",
+        ANESetObjectProperty(bytearrayObj, "length", lengthObj, nullptr));
+
+    FREByteArray ba;
+    DO_OR_FAIL("Failed to acquire bytearray", FREAcquireByteArray(bytearrayObj, &ba));
+
+    std::copy(tagInfo.begin(), tagInfo.end(), ba.bytes);
+
+    std::copy(abc.begin(), abc.end(), ba.bytes + tagInfo.size());
+
+    DO_OR_FAIL("Failed to release bytearray", FREReleaseByteArray(bytearrayObj));
+
+    return bytearrayObj;
+}